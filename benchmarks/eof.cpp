@@ -0,0 +1,69 @@
+// Times many short parses whose last repetition probes past the end of the
+// input, the case that used to cost an exception unwind per parse, next to
+// the same parses where the probe fails on a terminator instead.
+//
+// Build against the headers of the revision to measure:
+//     g++ -O2 -std=c++17 -I ufpeg/booster benchmarks/eof.cpp -o eof
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compiler.hpp"
+#include "executor.hpp"
+
+using namespace ufpeg;
+
+std::shared_ptr<Expression> make_grammar() {
+    auto letter = std::make_shared<RangeExpression>(U'a', U'z');
+    auto word = std::make_shared<SequenceExpression>(std::vector<std::shared_ptr<Expression>>({
+        letter, std::make_shared<ZeroOrMoreExpression>(letter),
+    }));
+    auto separated = std::make_shared<SequenceExpression>(std::vector<std::shared_ptr<Expression>>({
+        std::make_shared<RuleReferenceExpression>(U"word"),
+        std::make_shared<ZeroOrOneExpression>(std::make_shared<LiteralExpression>(U" ")),
+    }));
+
+    return std::make_shared<GrammarExpression>(std::vector<std::shared_ptr<Expression>>({
+        std::make_shared<RuleDefinitionExpression>(U"words", std::make_shared<ZeroOrMoreExpression>(separated)),
+        std::make_shared<RuleDefinitionExpression>(U"word", word),
+    }));
+}
+
+double measure(const Executor &executor, const std::vector<std::u32string> &inputs, std::size_t rounds) {
+    std::size_t size = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t round = 0; round < rounds; round++) {
+        for (const auto &input: inputs) {
+            size += executor.execute(input).get_size();
+        }
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (size == 0) {
+        std::cerr << "nothing was parsed" << std::endl;
+    }
+
+    return elapsed.count();
+}
+
+int main(int argc, char **argv) {
+    const std::size_t rounds = argc > 1 ? std::stoul(argv[1]) : 300000;
+
+    Compiler compiler;
+    const Executor executor(compiler.compile(make_grammar()));
+
+    const std::vector<std::u32string> eof = { U"a", U"ab cd", U"abc def ghi", U"x y z w" };
+    std::vector<std::u32string> terminated;
+
+    for (const auto &input: eof) {
+        terminated.push_back(input + U";");
+    }
+
+    std::cout << "eof-heavy:  " << measure(executor, eof, rounds) << "s" << std::endl;
+    std::cout << "terminated: " << measure(executor, terminated, rounds) << "s" << std::endl;
+}
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Runs benchmarks/eof.cpp against the headers of every given revision, e.g.
+#     benchmarks/eof.sh 85aadc8~1 85aadc8
+# compares exception-based end-of-input handling with the sentinel. Without
+# arguments it measures the working tree.
+set -e
+
+root=$(git -C "$(dirname "$0")" rev-parse --show-toplevel)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+run() {
+    g++ -O2 -std=c++17 -I "$1" "$root/benchmarks/eof.cpp" -o "$work/eof"
+    "$work/eof" "$ROUNDS"
+}
+
+ROUNDS=${ROUNDS:-300000}
+
+if [ $# -eq 0 ]; then
+    echo "== working tree"
+    run "$root/ufpeg/booster"
+    exit
+fi
+
+for revision in "$@"; do
+    mkdir -p "$work/$revision"
+    git -C "$root" archive "$revision" ufpeg/booster | tar -x -C "$work/$revision"
+    echo "== $revision"
+    run "$work/$revision/ufpeg/booster"
+done
@@ -0,0 +1,73 @@
+// Parses a long right-recursive list, list = item ";" / item "," list, and
+// reports how many backtracking stack entries each element kept alive at
+// the deepest point. With tail calls the recursive invocation pushes no
+// frame or mark, so only the node that nests the rest of the list remains.
+//
+// Build against the headers of the revision to measure:
+//     g++ -O2 -std=c++17 -I ufpeg/booster benchmarks/tail.cpp -o tail
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compiler.hpp"
+#include "executor.hpp"
+
+using namespace ufpeg;
+
+std::shared_ptr<Expression> make_grammar() {
+    auto item = std::make_shared<RuleReferenceExpression>(U"item");
+
+    return std::make_shared<GrammarExpression>(std::vector<std::shared_ptr<Expression>>({
+        std::make_shared<RuleDefinitionExpression>(U"list", std::make_shared<ChoiceExpression>(
+            std::vector<std::shared_ptr<Expression>>({
+                std::make_shared<SequenceExpression>(std::vector<std::shared_ptr<Expression>>({
+                    item, std::make_shared<LiteralExpression>(U";"),
+                })),
+                std::make_shared<SequenceExpression>(std::vector<std::shared_ptr<Expression>>({
+                    item,
+                    std::make_shared<LiteralExpression>(U","),
+                    std::make_shared<RuleReferenceExpression>(U"list"),
+                })),
+            })
+        )),
+        std::make_shared<RuleDefinitionExpression>(U"item", std::make_shared<RangeExpression>(U'a', U'z')),
+    }));
+}
+
+void measure(bool optimize, const std::u32string &text, std::size_t elements) {
+    CompilerSettings settings;
+    settings.optimize = optimize;
+
+    Compiler compiler(settings);
+    const Executor executor(compiler.compile(make_grammar()));
+
+    // Growing one block at a time keeps the capacity within a block of
+    // the deepest the stack ever got.
+    ExecutorContext context({ 0, 1, 1024 });
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto tree = executor.execute(context, text.data(), text.length());
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << (optimize ? "optimized:   " : "unoptimized: ")
+        << static_cast<double>(context.stack.get_capacity()) / elements << " entries per element, "
+        << tree.get_size() << " nodes, " << elapsed.count() << "s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    const std::size_t elements = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+    std::u32string text;
+
+    for (std::size_t i = 1; i < elements; i++) {
+        text += U"x,";
+    }
+
+    text += U"x;";
+
+    measure(false, text, elements);
+    measure(true, text, elements);
+}
@@ -11,7 +11,51 @@ def get_long_description():
 def get_ext_modules():
     base = 'ufpeg/booster'
     sources = ['ufpegbooster.cpp']
-    depends = ['node.hpp', 'context.hpp', 'instructions.hpp', 'vm.hpp']
+    depends = [
+        'alternative.hpp',
+        'backtrackstack.hpp',
+        'bootstrap.hpp',
+        'characterset.hpp',
+        'checkpoint.hpp',
+        'checkpointtext.hpp',
+        'compileoptions.hpp',
+        'compiler.hpp',
+        'compilercontext.hpp',
+        'compilersettings.hpp',
+        'definition.hpp',
+        'document.hpp',
+        'executor.hpp',
+        'executorcontext.hpp',
+        'expectationset.hpp',
+        'expressions.hpp',
+        'first.hpp',
+        'frame.hpp',
+        'growthpolicy.hpp',
+        'instructions.hpp',
+        'literalset.hpp',
+        'mark.hpp',
+        'memo.hpp',
+        'node.hpp',
+        'nodevisitor.hpp',
+        'opennode.hpp',
+        'optimizer.hpp',
+        'optimizerreport.hpp',
+        'parallelexecutor.hpp',
+        'program.hpp',
+        'recall.hpp',
+        'recognition.hpp',
+        'reference.hpp',
+        'ruleoptions.hpp',
+        'scheduler.hpp',
+        'session.hpp',
+        'span.hpp',
+        'stackentry.hpp',
+        'streamtext.hpp',
+        'symboltable.hpp',
+        'text.hpp',
+        'trienode.hpp',
+        'utf8.hpp',
+    ]
     booster = Extension(
         'ufpeg.booster',
         sources=[join(base, src) for src in sources],
@@ -0,0 +1,17 @@
+#ifndef UFPEG_ALTERNATIVE_HPP
+#define UFPEG_ALTERNATIVE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ufpeg {
+    class Expression;
+
+    struct Alternative {
+        std::u32string rule;
+        std::vector<std::shared_ptr<Expression>> items;
+    };
+}
+
+#endif
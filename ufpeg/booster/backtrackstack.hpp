@@ -0,0 +1,138 @@
+#ifndef UFPEG_BACKTRACK_STACK_HPP
+#define UFPEG_BACKTRACK_STACK_HPP
+
+#include <vector>
+
+#include "growthpolicy.hpp"
+#include "stackentry.hpp"
+
+namespace ufpeg {
+    // Every piece of state the executor has to restore on the way back,
+    // kept as tagged entries in one contiguous buffer. The buffer is only
+    // ever grown as the policy says and clear() keeps it, so a context that
+    // is reset between parses stops allocating once it is warm.
+    class BacktrackStack {
+    public:
+        BacktrackStack(const GrowthPolicy &policy = {}):
+            policy(policy) {
+            this->entries.reserve(policy.initial);
+        }
+
+        void push_frame(const Frame &frame) {
+            this->push(StackTag::FRAME).frame = frame;
+        }
+
+        void push_node(const OpenNode &node) {
+            this->push(StackTag::NODE).node = node;
+        }
+
+        void push_mark(const Mark &mark) {
+            this->push(StackTag::MARK).mark = mark;
+        }
+
+        void push_recall(const Recall &recall) {
+            this->push(StackTag::RECALL).recall = recall;
+        }
+
+        Frame pop_frame() {
+            const auto frame = this->entries.back().frame;
+            this->pop();
+            return frame;
+        }
+
+        // A factored choice closes its node from inside the sequences that
+        // follow the shared prefix, so the marks of those sequences may
+        // still be above it. The entry is then left in place as CLOSED and
+        // dropped once the marks above it are gone.
+        OpenNode pop_node() {
+            auto it = this->entries.end() - 1;
+
+            if (it->tag == StackTag::NODE) {
+                const auto node = it->node;
+                this->pop();
+                return node;
+            }
+
+            while (it->tag != StackTag::NODE) {
+                --it;
+            }
+
+            it->tag = StackTag::CLOSED;
+            return it->node;
+        }
+
+        Mark pop_mark() {
+            const auto mark = this->entries.back().mark;
+            this->pop();
+            return mark;
+        }
+
+        Recall pop_recall() {
+            const auto recall = this->entries.back().recall;
+            this->pop();
+            return recall;
+        }
+
+        void pop() {
+            this->entries.pop_back();
+
+            while (!this->entries.empty() && this->entries.back().tag == StackTag::CLOSED) {
+                this->entries.pop_back();
+            }
+        }
+
+        void clear() {
+            this->entries.clear();
+        }
+
+        bool empty() const {
+            return this->entries.empty();
+        }
+
+        std::size_t size() const {
+            return this->entries.size();
+        }
+
+        std::size_t get_capacity() const {
+            return this->entries.capacity();
+        }
+
+        const GrowthPolicy &get_policy() const {
+            return this->policy;
+        }
+
+        std::vector<StackEntry>::iterator begin() {
+            return this->entries.begin();
+        }
+
+        std::vector<StackEntry>::iterator end() {
+            return this->entries.end();
+        }
+
+        std::vector<StackEntry>::const_iterator begin() const {
+            return this->entries.begin();
+        }
+
+        std::vector<StackEntry>::const_iterator end() const {
+            return this->entries.end();
+        }
+    private:
+        StackEntry &push(StackTag tag) {
+            if (this->entries.size() == this->entries.capacity()) {
+                this->entries.reserve(this->policy.get_capacity(this->entries.capacity()));
+            }
+
+            this->entries.emplace_back();
+
+            auto &entry = this->entries.back();
+            entry.tag = tag;
+
+            return entry;
+        }
+
+        GrowthPolicy policy;
+        std::vector<StackEntry> entries;
+    };
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef UFPEG_CHARACTER_SET_HPP
+#define UFPEG_CHARACTER_SET_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ufpeg {
+    typedef std::vector<std::pair<char32_t, char32_t>> CharacterRanges;
+
+    inline bool is_ascii(const CharacterRanges &ranges) {
+        return std::all_of(
+            ranges.begin(), ranges.end(), [](const std::pair<char32_t, char32_t> &range) {
+                return range.second < 0x80;
+            }
+        );
+    }
+
+    inline bool overlaps(const CharacterRanges &ranges, const CharacterRanges &others) {
+        return std::any_of(
+            ranges.begin(), ranges.end(), [&others](const std::pair<char32_t, char32_t> &range) {
+                return std::any_of(
+                    others.begin(), others.end(), [&range](const std::pair<char32_t, char32_t> &other) {
+                        return range.first <= other.second && other.first <= range.second;
+                    }
+                );
+            }
+        );
+    }
+
+    class CharacterSet {
+    public:
+        CharacterSet(CharacterRanges ranges) {
+            std::sort(ranges.begin(), ranges.end());
+
+            for (const auto &range: ranges) {
+                if (!this->ranges.empty() && range.first <= this->ranges.back().second + 1) {
+                    auto &last = this->ranges.back();
+                    last.second = std::max(last.second, range.second);
+                } else {
+                    this->ranges.emplace_back(range);
+                }
+            }
+
+            for (const auto &range: this->ranges) {
+                if (range.first > 0xFF) {
+                    break;
+                }
+
+                const auto max = std::min<char32_t>(range.second, 0xFF);
+
+                for (auto code = range.first; code <= max; code++) {
+                    this->bitmap[code >> 6] |= std::uint64_t(1) << (code & 0x3F);
+                }
+
+                this->byte_ranges.emplace_back(range.first, max);
+            }
+        }
+
+        bool contains(char32_t code) const {
+            if (code <= 0xFF) {
+                return (this->bitmap[code >> 6] >> (code & 0x3F)) & 1;
+            }
+
+            auto it = std::upper_bound(
+                this->ranges.begin(), this->ranges.end(), code,
+                [](char32_t code, const std::pair<char32_t, char32_t> &range) {
+                    return code < range.first;
+                }
+            );
+
+            return it != this->ranges.begin() && code <= std::prev(it)->second;
+        }
+
+        const CharacterRanges &get_ranges() const {
+            return this->ranges;
+        }
+
+        const std::vector<std::pair<std::uint8_t, std::uint8_t>> &get_byte_ranges() const {
+            return this->byte_ranges;
+        }
+    private:
+        std::uint64_t bitmap[4] = { 0, 0, 0, 0 };
+        CharacterRanges ranges;
+        std::vector<std::pair<std::uint8_t, std::uint8_t>> byte_ranges;
+    };
+}
+
+#endif
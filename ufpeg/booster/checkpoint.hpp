@@ -0,0 +1,39 @@
+#ifndef UFPEG_CHECKPOINT_HPP
+#define UFPEG_CHECKPOINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "backtrackstack.hpp"
+#include "frame.hpp"
+#include "memo.hpp"
+#include "node.hpp"
+#include "opennode.hpp"
+
+namespace ufpeg {
+    // A paused executor, kept so a document can resume from it. Besides
+    // the registers and the stack it keeps the records the stack still
+    // points into, as they were, since the run goes on to change them.
+    //
+    // examined is how far the text had been read when the run got here;
+    // lowest and smallest are the lowest position read and the fewest
+    // records held until the next checkpoint, and low and small the same
+    // until the end of the run. The memos are those starting between this
+    // checkpoint and the next, with positions relative to the cursor.
+    struct Checkpoint {
+        BacktrackStack stack;
+        Frame frame;
+        OpenNode node;
+        std::size_t cursor, pointer, reach, floor, committed, offset;
+        std::size_t size, examined;
+        std::size_t lowest = SIZE_MAX, smallest = SIZE_MAX;
+        std::size_t low = SIZE_MAX, small = SIZE_MAX;
+        std::vector<std::pair<std::size_t, NodeRecord>> records;
+        std::map<std::pair<std::size_t, std::size_t>, Memo> memos;
+    };
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef UFPEG_CHECKPOINT_TEXT_HPP
+#define UFPEG_CHECKPOINT_TEXT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+#include "executorcontext.hpp"
+#include "text.hpp"
+
+namespace ufpeg {
+    // Where the next checkpoint goes, and what the run has read and kept
+    // since the last one. Unless the depth is fixed, it is the shallowest
+    // the stack has been since then.
+    struct Interval {
+        std::size_t stop, limit, depth;
+        bool fixed;
+        std::size_t lowest, smallest;
+    };
+
+    // A complete text that pauses the executor for the next checkpoint, and
+    // otherwise records what each operation depends on. Past the stop it
+    // waits for the stack to be as shallow as the interval's depth, so that
+    // checkpoints fall between rules rather than inside them; past the limit
+    // it pauses anyway.
+    template <typename T>
+    class CheckpointText {
+    public:
+        CheckpointText(const T *data, std::size_t length, ExecutorContext &context, Interval &interval):
+            text(data, length), context(context), interval(interval) {}
+
+        // SPAN asks once it has read up to the position, so the reach is
+        // kept up to date even when pausing, just as if it had not.
+        bool is_available(std::size_t position, std::size_t length) const {
+            this->context.reach = std::max(this->context.reach, position + length);
+
+            const auto depth = this->context.stack.size();
+
+            if (position >= this->interval.stop && (depth <= this->interval.depth || position >= this->interval.limit)) {
+                return false;
+            }
+
+            if (!this->interval.fixed) {
+                this->interval.depth = std::min(this->interval.depth, depth);
+            }
+
+            this->interval.lowest = std::min(this->interval.lowest, position);
+            this->interval.smallest = std::min(this->interval.smallest, this->context.records.size());
+
+            return true;
+        }
+
+        bool matches(std::size_t position, const std::u32string &literal) const {
+            return this->text.matches(position, literal);
+        }
+
+        char32_t at(std::size_t position) const {
+            return this->text.at(position);
+        }
+
+        std::size_t span(std::size_t position, const CharacterSet &set) const {
+            return this->text.span(position, set);
+        }
+
+        std::size_t get_length() const {
+            return this->text.get_length();
+        }
+    private:
+        const Text<T> text;
+        ExecutorContext &context;
+        Interval &interval;
+    };
+}
+
+#endif
@@ -10,6 +10,9 @@ namespace ufpeg {
         std::shared_ptr<Reference> entry;
         std::shared_ptr<Reference> success;
         std::shared_ptr<Reference> failure;
+        std::shared_ptr<Reference> cut;
+        bool committed = false;
+        bool global = false;
     };
 }
 
@@ -2,12 +2,16 @@
 #define UFPEG_COMPILER_HPP
 
 #include "expressions.hpp"
+#include "optimizer.hpp"
 
 namespace ufpeg {
     class Compiler {
     public:
-        std::vector<std::shared_ptr<Instruction>> compile(const std::shared_ptr<Expression> &root) {
-            CompilerContext context;
+        Compiler(const CompilerSettings &settings = {}):
+            settings(settings) {}
+
+        Program compile(const std::shared_ptr<Expression> &root) {
+            CompilerContext context = { this->settings };
 
             auto instructions = root->compile(context, {});
 
@@ -18,8 +22,32 @@ namespace ufpeg {
                 reference->resolve(offset);
             }
 
-            return instructions;
+            Program program;
+            program.symbols = context.symbols;
+            program.start = context.start;
+            program.operations.reserve(instructions.size());
+
+            for (const auto &instruction: instructions) {
+                program.operations.emplace_back(instruction->lower(program));
+            }
+
+            this->report = { program.operations.size(), program.operations.size() };
+
+            if (this->settings.optimize && !program.operations.empty()) {
+                Optimizer optimizer;
+                program = optimizer.optimize(program);
+                this->report = optimizer.get_report();
+            }
+
+            return program;
+        }
+
+        const OptimizerReport &get_report() const {
+            return this->report;
         }
+    private:
+        const CompilerSettings settings;
+        OptimizerReport report = { 0, 0 };
     };
 }
 
@@ -1,15 +1,83 @@
 #ifndef UFPEG_COMPILER_CONTEXT_HPP
 #define UFPEG_COMPILER_CONTEXT_HPP
 
-#include <string>
 #include <memory>
-#include <map>
+#include <vector>
 
 #include "reference.hpp"
+#include "symboltable.hpp"
+#include "compilersettings.hpp"
+#include "first.hpp"
+#include "definition.hpp"
 
 namespace ufpeg {
     struct CompilerContext {
-        std::map<std::u32string, std::shared_ptr<Reference>> references;
+        CompilerSettings settings;
+        SymbolTable symbols;
+        std::vector<std::shared_ptr<Reference>> references;
+        std::vector<First> firsts;
+        std::vector<Definition> definitions;
+        std::uint32_t start = NO_RULE;
+
+        std::shared_ptr<Reference> get_reference(std::uint32_t rule) {
+            if (rule >= this->references.size()) {
+                this->references.resize(rule + 1);
+            }
+
+            auto &reference = this->references[rule];
+            if (!reference) {
+                reference = std::make_shared<Reference>();
+            }
+
+            return reference;
+        }
+
+        Definition get_definition(std::uint32_t rule) const {
+            if (rule >= this->definitions.size()) {
+                return {};
+            }
+
+            return this->definitions[rule];
+        }
+
+        // Node rules build no node when the grammar is compiled to recognize
+        // input only; they are still memoized like before.
+        bool has_node(const Definition &definition) const {
+            return definition.options.node && !this->settings.recognize;
+        }
+
+        void set_definition(std::uint32_t rule, const Definition &definition) {
+            if (rule >= this->definitions.size()) {
+                this->definitions.resize(rule + 1);
+            }
+
+            this->definitions[rule] = definition;
+        }
+
+        First get_first(std::uint32_t rule) const {
+            if (rule >= this->firsts.size()) {
+                return { false, {} };
+            }
+
+            return this->firsts[rule];
+        }
+
+        bool set_first(std::uint32_t rule, const First &first) {
+            if (rule >= this->firsts.size()) {
+                this->firsts.resize(rule + 1, { false, {} });
+            }
+
+            auto &current = this->firsts[rule];
+            const auto ranges = CharacterSet(first.ranges).get_ranges();
+
+            if (current.nullable == first.nullable && current.ranges == ranges) {
+                return false;
+            }
+
+            current = { first.nullable, ranges };
+
+            return true;
+        }
     };
 }
 
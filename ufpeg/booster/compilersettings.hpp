@@ -0,0 +1,19 @@
+#ifndef UFPEG_COMPILER_SETTINGS_HPP
+#define UFPEG_COMPILER_SETTINGS_HPP
+
+#include <cstddef>
+
+namespace ufpeg {
+    struct CompilerSettings {
+        bool memoize = false;
+        bool utf8 = false;
+        bool factor = true;
+        bool cut = true;
+        std::size_t inline_limit = 8;
+        bool optimize = true;
+        bool recognize = false;
+        bool expect = false;
+    };
+}
+
+#endif
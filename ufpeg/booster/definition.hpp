@@ -0,0 +1,20 @@
+#ifndef UFPEG_DEFINITION_HPP
+#define UFPEG_DEFINITION_HPP
+
+#include <cstddef>
+#include <memory>
+
+#include "ruleoptions.hpp"
+
+namespace ufpeg {
+    class Expression;
+
+    struct Definition {
+        std::shared_ptr<Expression> item;
+        RuleOptions options;
+        bool recursive = false;
+        std::size_t size = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,799 @@
+#ifndef UFPEG_DOCUMENT_HPP
+#define UFPEG_DOCUMENT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "checkpointtext.hpp"
+#include "executor.hpp"
+
+namespace ufpeg {
+    // A text that is parsed again after every batch of edits. The run is
+    // paused every so often to keep a checkpoint. A reparse resumes from
+    // the last checkpoint that had read nothing the edits touched, and once
+    // it gets past them it stops as soon as it is back in a state the
+    // previous run had, taking the rest of the records, checkpoints and
+    // memos from that run.
+    template <typename T>
+    class Document {
+    public:
+        Document(const Executor &executor, const T *data, std::size_t length, std::size_t spacing = 1024):
+            executor(executor), text(data, data + length), spacing(spacing) {
+            const auto &operations = executor.get_program().operations;
+
+            const auto memoized = std::any_of(operations.begin(), operations.end(), [](const Operation &operation) {
+                return operation.opcode == Opcode::RECALL;
+            });
+
+            if (!memoized) {
+                throw std::invalid_argument("Document needs a program compiled with memoize");
+            }
+
+            ExecutorContext context;
+
+            this->executor.start(context);
+            context.pruning = false;
+
+            this->checkpoints.emplace_back();
+            this->capture(this->checkpoints.back(), context);
+
+            Resume resume = {};
+            this->run(context, resume);
+        }
+
+        void edit(std::size_t offset, std::size_t removed, const T *data, std::size_t length) {
+            if (offset > this->text.size() || removed > this->text.size() - offset) {
+                throw std::out_of_range("Edit is out of range");
+            }
+
+            if (removed == 0 && length == 0) {
+                return;
+            }
+
+            this->text.erase(this->text.begin() + offset, this->text.begin() + offset + removed);
+            this->text.insert(this->text.begin() + offset, data, data + length);
+
+            auto &damage = this->damage;
+
+            if (!this->damaged) {
+                damage = { offset, offset, offset };
+                this->damaged = true;
+            }
+
+            const auto end = std::max(damage.end, offset + removed);
+
+            damage.start = std::min(damage.start, offset);
+            damage.stop = end - damage.end + damage.stop;
+            damage.end = end - removed + length;
+        }
+
+        void parse() {
+            if (!this->damaged) {
+                return;
+            }
+
+            this->damaged = false;
+
+            Resume resume = {};
+            resume.damage = this->damage;
+
+            // An insertion takes the character after it along, so that the
+            // start of the damage is only ever a position before it.
+            if (resume.damage.start == resume.damage.stop) {
+                resume.damage.stop++;
+                resume.damage.end++;
+            }
+
+            auto records = this->release();
+            const auto resumed = this->find_resumable(resume.damage.start);
+            const auto &checkpoint = this->checkpoints[resumed];
+
+            resume.resumed = checkpoint.size;
+            resume.tail.assign(records.begin() + checkpoint.size, records.end());
+            records.resize(checkpoint.size);
+
+            // A record may be saved more than once, as the last one of both
+            // a node and a mark, so the finals are all taken before any is
+            // put back.
+            for (const auto &entry: checkpoint.records) {
+                resume.finals.push_back({ entry.first, records[entry.first] });
+            }
+
+            for (const auto &entry: checkpoint.records) {
+                records[entry.first] = entry.second;
+            }
+
+            std::sort(resume.finals.begin(), resume.finals.end(), [](
+                const std::pair<std::size_t, NodeRecord> &left,
+                const std::pair<std::size_t, NodeRecord> &right
+            ) {
+                return left.first < right.first;
+            });
+
+            resume.checkpoints.assign(
+                std::make_move_iterator(this->checkpoints.begin() + resumed + 1),
+                std::make_move_iterator(this->checkpoints.end())
+            );
+            this->checkpoints.erase(this->checkpoints.begin() + resumed + 1, this->checkpoints.end());
+
+            ExecutorContext context;
+
+            context.records = std::move(records);
+            this->restore(context, this->checkpoints.back());
+            this->invalidate(context, resume.damage);
+            this->run(context, resume);
+        }
+
+        std::shared_ptr<const Tree> get_tree() const {
+            return this->tree;
+        }
+
+        const std::vector<T> &get_text() const {
+            return this->text;
+        }
+
+        bool is_matched() const {
+            return this->matched;
+        }
+    private:
+        // The edits since the last parse, as one span: [start, stop) in the
+        // text that was parsed is [start, end) in the current one.
+        struct Damage {
+            std::size_t start, stop, end;
+        };
+
+        // Where the values of the previous run go in this one. Records
+        // before those kept from the checkpoint resumed from stay put, the
+        // rest move by however many records more or fewer this run has when
+        // it catches up with the previous one.
+        struct Shift {
+            Damage damage;
+            std::size_t resumed, old_size, new_size;
+
+            std::size_t position(std::size_t position) const {
+                if (position <= this->damage.start || position == SIZE_MAX) {
+                    return position;
+                }
+
+                if (position < this->damage.stop) {
+                    return this->damage.end;
+                }
+
+                return position - this->damage.stop + this->damage.end;
+            }
+
+            std::size_t index(std::size_t index) const {
+                if (index < this->resumed || index == NO_NODE) {
+                    return index;
+                }
+
+                return index - this->old_size + this->new_size;
+            }
+
+            // Positions inside the damage have nothing to match.
+            bool same_position(std::size_t before, std::size_t after) const {
+                if (before > this->damage.start && before < this->damage.stop) {
+                    return false;
+                }
+
+                return after == this->position(before);
+            }
+
+            // Records this run has fewer of than the previous one map out of
+            // range, which must not pass for NO_NODE.
+            bool same_index(std::size_t before, std::size_t after) const {
+                if (before == NO_NODE) {
+                    return after == NO_NODE;
+                }
+
+                return after == this->index(before) && after != NO_NODE;
+            }
+        };
+
+        // What is left of the previous run while this one catches up: its
+        // checkpoints after the one resumed from, its records from there on,
+        // and how the records that checkpoint saved ended up.
+        struct Resume {
+            Damage damage;
+            std::size_t resumed, loaded;
+            std::vector<Checkpoint> checkpoints;
+            std::vector<NodeRecord> tail;
+            std::vector<std::pair<std::size_t, NodeRecord>> finals;
+        };
+
+        void run(ExecutorContext &context, Resume &resume) {
+            const auto resumed = this->checkpoints.size() - 1;
+
+            Interval interval;
+            CheckpointText<T> input(this->text.data(), this->text.size(), context, interval);
+
+            this->start(interval, context, resume);
+
+            while (!this->executor.run(context, input)) {
+                auto &last = this->checkpoints.back();
+
+                last.lowest = interval.lowest;
+                last.smallest = interval.smallest;
+
+                if (this->converge(context, resume, resumed)) {
+                    return;
+                }
+
+                this->checkpoints.emplace_back();
+                this->capture(this->checkpoints.back(), context);
+                this->start(interval, context, resume);
+            }
+
+            auto &last = this->checkpoints.back();
+
+            last.lowest = interval.lowest;
+            last.smallest = std::min(interval.smallest, context.records.size());
+
+            this->finish(this->checkpoints.size(), SIZE_MAX, SIZE_MAX, resumed);
+            this->store(context);
+            this->matched = Executor::is_matched(context);
+            this->tree = std::make_shared<Tree>(std::move(context.records));
+        }
+
+        // The next checkpoint goes a spacing further on, or further still
+        // while the stack is deep so that copying it stays linear. Past the
+        // damage it goes where the previous run kept its next one instead,
+        // when that is in reach, and only as deep as that one was, to see
+        // if this run has caught up with it.
+        void start(Interval &interval, ExecutorContext &context, Resume &resume) {
+            const auto &damage = resume.damage;
+            const auto cursor = context.cursor;
+            const auto span = std::max(this->spacing, context.stack.size());
+
+            interval = { cursor + span, cursor + 2 * span, SIZE_MAX, false, SIZE_MAX, SIZE_MAX };
+
+            const auto it = std::partition_point(
+                resume.checkpoints.begin(), resume.checkpoints.end(), [&](const Checkpoint &checkpoint) {
+                    return checkpoint.cursor < damage.stop || checkpoint.cursor + damage.end <= cursor + damage.stop;
+                }
+            );
+
+            if (it != resume.checkpoints.end()) {
+                const auto target = it->cursor - damage.stop + damage.end;
+                const auto next = it + 1;
+
+                if (target <= interval.limit) {
+                    interval.stop = target;
+                    interval.limit = target + span;
+                    interval.depth = it->stack.size();
+                    interval.fixed = true;
+
+                    if (next != resume.checkpoints.end()) {
+                        interval.limit = std::min(interval.limit, next->cursor - damage.stop + damage.end);
+                    }
+                }
+            }
+
+            this->load(context, resume, interval.limit);
+        }
+
+        bool converge(ExecutorContext &context, Resume &resume, std::size_t resumed) {
+            const auto &damage = resume.damage;
+
+            if (context.cursor < damage.end) {
+                return false;
+            }
+
+            const auto cursor = context.cursor - damage.end + damage.stop;
+
+            const auto it = std::lower_bound(
+                resume.checkpoints.begin(), resume.checkpoints.end(), cursor,
+                [](const Checkpoint &checkpoint, std::size_t cursor) {
+                    return checkpoint.cursor < cursor;
+                }
+            );
+
+            if (it == resume.checkpoints.end() || it->cursor != cursor) {
+                return false;
+            }
+
+            // The rest of the previous run must neither have read anything
+            // before the damage ended nor have dropped records it had here.
+            if (it->low < damage.stop || it->small < it->size) {
+                return false;
+            }
+
+            const Shift shift = { damage, resume.resumed, it->size, context.records.size() };
+
+            if (!this->matches(context, *it, shift)) {
+                return false;
+            }
+
+            const auto first = std::distance(resume.checkpoints.begin(), it);
+
+            this->load_before(context, resume, first);
+            this->splice(context, resume, first, shift, resumed);
+
+            return true;
+        }
+
+        // Whether the previous run would go on the same way from its
+        // checkpoint as this one from where it is. That is the case when
+        // all the state the rest of that run reads is the same: the
+        // registers and the stack, and the children of the open nodes.
+        bool matches(const ExecutorContext &context, const Checkpoint &checkpoint, const Shift &shift) const {
+            if (context.pointer != checkpoint.pointer ||
+                !same_frame(context.frame, checkpoint.frame) ||
+                !shift.same_index(checkpoint.node.index, context.node.index) ||
+                !shift.same_index(checkpoint.node.last, context.node.last) ||
+                !shift.same_position(checkpoint.reach, context.reach) ||
+                context.stack.size() != checkpoint.stack.size()) {
+                return false;
+            }
+
+            auto saved = checkpoint.records.begin();
+
+            if (!shift.same_index(saved->second.child, context.records[context.node.index].child)) {
+                return false;
+            }
+
+            ++saved;
+
+            auto it = context.stack.begin();
+
+            for (const auto &before: checkpoint.stack) {
+                const auto &after = *it++;
+
+                if (before.tag != after.tag) {
+                    return false;
+                }
+
+                switch (before.tag) {
+                case StackTag::FRAME:
+                    if (!same_frame(before.frame, after.frame)) {
+                        return false;
+                    }
+                    break;
+                case StackTag::NODE: {
+                    const auto &child = context.records[after.node.index].child;
+                    if (!shift.same_index(before.node.index, after.node.index) ||
+                        !shift.same_index(before.node.last, after.node.last) ||
+                        !shift.same_index((saved++)->second.child, child)) {
+                        return false;
+                    }
+                    break;
+                }
+                case StackTag::MARK:
+                    if (!shift.same_index(before.mark.size, after.mark.size) ||
+                        !shift.same_index(before.mark.last, after.mark.last) ||
+                        !shift.same_position(before.mark.cursor, after.mark.cursor)) {
+                        return false;
+                    }
+                    break;
+                case StackTag::RECALL:
+                    if (!shift.same_position(before.recall.reach, after.recall.reach) ||
+                        !shift.same_position(before.recall.start, after.recall.start) ||
+                        !shift.same_index(before.recall.size, after.recall.size)) {
+                        return false;
+                    }
+                    break;
+                case StackTag::CLOSED:
+                    break;
+                }
+            }
+
+            return true;
+        }
+
+        static bool same_frame(const Frame &left, const Frame &right) {
+            return left.success == right.success && left.failure == right.failure && left.pending == right.pending;
+        }
+
+        // Finishes this run with the rest of the previous one: what it still
+        // changed in the records it had, the records it added, and its
+        // checkpoints, moved to where they are now.
+        void splice(ExecutorContext &context, Resume &resume, std::size_t first, const Shift &shift, std::size_t resumed) {
+            auto &records = context.records;
+            const auto &checkpoint = resume.checkpoints[first];
+
+            for (const auto &entry: checkpoint.records) {
+                const auto final = this->get_final(resume, entry.first);
+
+                if (!final) {
+                    continue;
+                }
+
+                const auto &before = entry.second;
+                auto &record = records[shift.index(entry.first)];
+
+                if (final->rule != before.rule) {
+                    record.rule = final->rule;
+                }
+                if (final->stop != before.stop) {
+                    record.stop = shift.position(final->stop);
+                }
+                if (final->child != before.child) {
+                    record.child = shift.index(final->child);
+                }
+                if (final->sibling != before.sibling) {
+                    record.sibling = shift.index(final->sibling);
+                }
+            }
+
+            for (auto it = resume.tail.begin() + (checkpoint.size - resume.resumed); it != resume.tail.end(); ++it) {
+                auto record = *it;
+                record.start = shift.position(record.start);
+                record.stop = shift.position(record.stop);
+                record.child = shift.index(record.child);
+                record.sibling = shift.index(record.sibling);
+                records.push_back(record);
+            }
+
+            const auto examined = get_examined(context);
+            const auto last = this->checkpoints.size();
+
+            for (auto it = resume.checkpoints.begin() + first; it != resume.checkpoints.end(); ++it) {
+                this->checkpoints.push_back(std::move(*it));
+                this->relocate(this->checkpoints.back(), records, resume, shift, examined);
+            }
+
+            this->finish(last, this->checkpoints[last].low, this->checkpoints[last].small, resumed);
+            this->store(context);
+            this->tree = std::make_shared<Tree>(std::move(records));
+        }
+
+        // Moves a checkpoint of the previous run to this one. The records it
+        // saved that were added after the runs met move like any others;
+        // the older ones are as this run has them, except for what the
+        // previous run went on to change after the checkpoint.
+        void relocate(
+            Checkpoint &checkpoint,
+            const std::vector<NodeRecord> &records,
+            const Resume &resume,
+            const Shift &shift,
+            std::size_t examined
+        ) const {
+            const auto &damage = shift.damage;
+
+            checkpoint.node = { shift.index(checkpoint.node.index), shift.index(checkpoint.node.last) };
+            checkpoint.cursor = shift.position(checkpoint.cursor);
+            checkpoint.reach = shift.position(checkpoint.reach);
+            checkpoint.floor = shift.position(checkpoint.floor);
+            checkpoint.offset = shift.position(checkpoint.offset);
+            checkpoint.committed = shift.index(checkpoint.committed);
+            checkpoint.size = shift.index(checkpoint.size);
+            checkpoint.lowest = shift.position(checkpoint.lowest);
+            checkpoint.low = shift.position(checkpoint.low);
+            checkpoint.smallest = shift.index(checkpoint.smallest);
+            checkpoint.small = shift.index(checkpoint.small);
+
+            if (checkpoint.examined >= damage.stop) {
+                checkpoint.examined = shift.position(checkpoint.examined);
+            }
+            checkpoint.examined = std::max(checkpoint.examined, examined);
+
+            for (auto &entry: checkpoint.stack) {
+                switch (entry.tag) {
+                case StackTag::NODE:
+                case StackTag::CLOSED:
+                    entry.node = { shift.index(entry.node.index), shift.index(entry.node.last) };
+                    break;
+                case StackTag::MARK:
+                    entry.mark.size = shift.index(entry.mark.size);
+                    entry.mark.last = shift.index(entry.mark.last);
+                    entry.mark.cursor = shift.position(entry.mark.cursor);
+                    break;
+                case StackTag::RECALL:
+                    entry.recall.reach = shift.position(entry.recall.reach);
+                    entry.recall.start = shift.position(entry.recall.start);
+                    entry.recall.size = shift.index(entry.recall.size);
+                    break;
+                case StackTag::FRAME:
+                    break;
+                }
+            }
+
+            for (auto &entry: checkpoint.records) {
+                const auto index = entry.first;
+                auto &record = entry.second;
+
+                entry.first = shift.index(index);
+
+                if (index >= shift.old_size) {
+                    record.start = shift.position(record.start);
+                    record.stop = shift.position(record.stop);
+                    record.child = shift.index(record.child);
+                    record.sibling = shift.index(record.sibling);
+                    continue;
+                }
+
+                const auto final = this->get_final(resume, index);
+                auto moved = records[entry.first];
+
+                if (final && final->rule != record.rule) {
+                    moved.rule = record.rule;
+                }
+                if (final && final->stop != record.stop) {
+                    moved.stop = record.stop;
+                }
+                if (final && final->child != record.child) {
+                    moved.child = shift.index(record.child);
+                }
+                if (final && final->sibling != record.sibling) {
+                    moved.sibling = shift.index(record.sibling);
+                }
+
+                record = moved;
+            }
+        }
+
+        // How the previous run left a record it already had at the checkpoint
+        // resumed from; those before it are only known if it saved them.
+        const NodeRecord *get_final(const Resume &resume, std::size_t index) const {
+            if (index >= resume.resumed) {
+                return &resume.tail[index - resume.resumed];
+            }
+
+            const auto it = std::lower_bound(
+                resume.finals.begin(), resume.finals.end(), index,
+                [](const std::pair<std::size_t, NodeRecord> &entry, std::size_t index) {
+                    return entry.first < index;
+                }
+            );
+
+            if (it == resume.finals.end() || it->first != index) {
+                return nullptr;
+            }
+
+            return &it->second;
+        }
+
+        // Works out the minima to the end of the run backwards from the
+        // checkpoint before `stop`, into those before the one resumed from
+        // only as long as they change.
+        void finish(std::size_t stop, std::size_t low, std::size_t small, std::size_t resumed) {
+            for (auto i = stop; i-- > 0;) {
+                auto &checkpoint = this->checkpoints[i];
+
+                low = std::min(low, checkpoint.lowest);
+                small = std::min(small, checkpoint.smallest);
+
+                if (i < resumed && checkpoint.low == low && checkpoint.small == small) {
+                    break;
+                }
+
+                checkpoint.low = low;
+                checkpoint.small = small;
+            }
+        }
+
+        // The last checkpoint that had read nothing from the damage on, and
+        // after which no records it had were dropped, so that the ones there
+        // now are still those it had.
+        std::size_t find_resumable(std::size_t start) const {
+            const auto it = std::upper_bound(
+                this->checkpoints.begin(), this->checkpoints.end(), start,
+                [](std::size_t start, const Checkpoint &checkpoint) {
+                    return start < checkpoint.examined;
+                }
+            );
+
+            auto resumed = static_cast<std::size_t>(std::distance(this->checkpoints.begin(), it)) - 1;
+
+            while (resumed != 0 && this->checkpoints[resumed].small < this->checkpoints[resumed].size) {
+                resumed--;
+            }
+
+            return resumed;
+        }
+
+        // The checkpoint whose memos a position belongs with.
+        std::size_t find(std::size_t position) const {
+            const auto it = std::upper_bound(
+                this->checkpoints.begin(), this->checkpoints.end(), position,
+                [](std::size_t position, const Checkpoint &checkpoint) {
+                    return position < checkpoint.cursor;
+                }
+            );
+
+            return static_cast<std::size_t>(std::distance(this->checkpoints.begin(), it)) - 1;
+        }
+
+        // Only the memos of the rules still pending at the checkpoint and
+        // those from where the rest of the run went back to may have read
+        // the damage; the ones from there on are loaded to be used again.
+        void invalidate(ExecutorContext &context, const Damage &damage) {
+            const auto resumed = this->checkpoints.size() - 1;
+            const auto &checkpoint = this->checkpoints[resumed];
+
+            for (auto i = this->find(checkpoint.low); i <= resumed; i++) {
+                load(context, this->checkpoints[i], damage);
+            }
+
+            for (const auto &entry: checkpoint.stack) {
+                if (entry.tag != StackTag::RECALL) {
+                    continue;
+                }
+
+                auto &bucket = this->checkpoints[this->find(entry.recall.start)];
+                auto &memos = bucket.memos;
+                const auto start = entry.recall.start - bucket.cursor;
+
+                for (auto it = memos.lower_bound({ start, 0 }); it != memos.end() && it->first.first == start;) {
+                    if (bucket.cursor + it->second.reach > damage.start) {
+                        it = memos.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        }
+
+        // Loads the memos of the previous run's checkpoints up to `stop`,
+        // as far as they are ahead of this run.
+        void load(ExecutorContext &context, Resume &resume, std::size_t stop) {
+            const auto &damage = resume.damage;
+
+            const auto it = std::partition_point(
+                resume.checkpoints.begin() + resume.loaded, resume.checkpoints.end(),
+                [&](const Checkpoint &checkpoint) {
+                    return checkpoint.cursor < damage.stop || checkpoint.cursor - damage.stop + damage.end <= stop;
+                }
+            );
+
+            this->load_before(context, resume, std::distance(resume.checkpoints.begin(), it));
+        }
+
+        static void load_before(ExecutorContext &context, Resume &resume, std::ptrdiff_t count) {
+            for (; resume.loaded < static_cast<std::size_t>(count); resume.loaded++) {
+                load(context, resume.checkpoints[resume.loaded], resume.damage);
+            }
+        }
+
+        // Moves the memos kept with a checkpoint into the context, without
+        // those that read the damage and with those after it moved along.
+        static void load(ExecutorContext &context, Checkpoint &checkpoint, const Damage &damage) {
+            const auto cursor = checkpoint.cursor;
+
+            for (auto &entry: checkpoint.memos) {
+                auto start = cursor + entry.first.first;
+                auto &memo = entry.second;
+
+                memo.reach += cursor;
+
+                if (memo.success) {
+                    memo.stop += cursor;
+                }
+
+                if (start >= damage.stop) {
+                    start = start - damage.stop + damage.end;
+                    memo.reach = memo.reach - damage.stop + damage.end;
+
+                    if (memo.success) {
+                        memo.stop = memo.stop - damage.stop + damage.end;
+                    }
+                } else if (memo.reach > damage.start) {
+                    continue;
+                }
+
+                context.memos.emplace(std::make_pair(start, entry.first.second), std::move(memo));
+            }
+
+            checkpoint.memos.clear();
+        }
+
+        // Puts the memos of the run back with the checkpoints they belong to.
+        void store(ExecutorContext &context) {
+            for (auto &entry: context.memos) {
+                const auto start = entry.first.first;
+                auto &checkpoint = this->checkpoints[this->find(start)];
+                auto &memo = entry.second;
+
+                memo.reach -= checkpoint.cursor;
+
+                if (memo.success) {
+                    memo.stop -= checkpoint.cursor;
+                }
+
+                checkpoint.memos[std::make_pair(start - checkpoint.cursor, entry.first.second)] = std::move(memo);
+            }
+
+            context.memos.clear();
+        }
+
+        // Saves the state of a paused run. The open nodes come first, in the
+        // order of the stack, followed by the nodes last added to them.
+        static void capture(Checkpoint &checkpoint, const ExecutorContext &context) {
+            const auto &records = context.records;
+
+            checkpoint.stack = context.stack;
+            checkpoint.frame = context.frame;
+            checkpoint.node = context.node;
+            checkpoint.cursor = context.cursor;
+            checkpoint.pointer = context.pointer;
+            checkpoint.reach = context.reach;
+            checkpoint.floor = context.floor;
+            checkpoint.committed = context.committed;
+            checkpoint.offset = context.offset;
+            checkpoint.size = records.size();
+            checkpoint.examined = get_examined(context);
+
+            auto &saved = checkpoint.records;
+            const auto save = [&](std::size_t index) {
+                if (index != NO_NODE) {
+                    saved.push_back({ index, records[index] });
+                }
+            };
+
+            save(context.node.index);
+
+            for (const auto &entry: context.stack) {
+                if (entry.tag == StackTag::NODE) {
+                    save(entry.node.index);
+                }
+            }
+
+            save(context.node.last);
+
+            for (const auto &entry: context.stack) {
+                if (entry.tag == StackTag::NODE) {
+                    save(entry.node.last);
+                } else if (entry.tag == StackTag::MARK) {
+                    save(entry.mark.last);
+                }
+            }
+        }
+
+        // CUT would drop the memos before it, which the next reparse is
+        // just as likely to need as any others.
+        static void restore(ExecutorContext &context, const Checkpoint &checkpoint) {
+            context.stack = checkpoint.stack;
+            context.frame = checkpoint.frame;
+            context.node = checkpoint.node;
+            context.cursor = checkpoint.cursor;
+            context.pointer = checkpoint.pointer;
+            context.reach = checkpoint.reach;
+            context.floor = checkpoint.floor;
+            context.committed = checkpoint.committed;
+            context.offset = checkpoint.offset;
+            context.splitting = false;
+            context.pruning = false;
+        }
+
+        // The reach of the innermost pending rule is only merged into those
+        // around it once it is memoized, so the run as a whole has read up
+        // to the furthest of them.
+        static std::size_t get_examined(const ExecutorContext &context) {
+            auto examined = context.reach;
+
+            for (const auto &entry: context.stack) {
+                if (entry.tag == StackTag::RECALL) {
+                    examined = std::max(examined, entry.recall.reach);
+                }
+            }
+
+            return examined;
+        }
+
+        // The records of the last tree, copied only if it is still shared.
+        std::vector<NodeRecord> release() {
+            if (this->tree.use_count() == 1) {
+                return this->tree->release();
+            }
+
+            return Tree(*this->tree).release();
+        }
+
+        const Executor &executor;
+        std::vector<T> text;
+        const std::size_t spacing;
+        std::vector<Checkpoint> checkpoints;
+        Damage damage;
+        bool damaged = false;
+        std::shared_ptr<Tree> tree;
+        bool matched = false;
+    };
+}
+
+#endif
@@ -1,32 +1,492 @@
 #ifndef UFPEG_EXECUTOR_HPP
 #define UFPEG_EXECUTOR_HPP
 
-#include "instructions.hpp"
+#include <algorithm>
+
+#include "program.hpp"
+#include "text.hpp"
+#include "executorcontext.hpp"
+#include "recognition.hpp"
 
 namespace ufpeg {
+    // The program is never modified after construction and all parse state
+    // lives in ExecutorContext, so an executor may be shared between threads
+    // as long as every thread runs it with a context of its own.
     class Executor {
     public:
-        Executor(const std::vector<std::shared_ptr<Instruction>> &instructions):
-            instructions(instructions) {}
+        Executor(const Program &program):
+            program(program) {}
+
+        Tree execute(const std::u32string &text) const {
+            return this->execute(text.data(), text.length());
+        }
+
+        Tree execute(const std::string &text) const {
+            return this->execute(
+                reinterpret_cast<const unsigned char*>(text.data()), text.length()
+            );
+        }
+
+        template <typename T>
+        Tree execute(const T *data, std::size_t length) const {
+            ExecutorContext context;
+
+            return this->execute(context, data, length);
+        }
+
+        template <typename T>
+        Tree execute(ExecutorContext &context, const T *data, std::size_t length) const {
+            this->start(context);
+            this->run(context, Text<T>(data, length));
+
+            return { std::move(context.records) };
+        }
+
+        Recognition recognize(const std::u32string &text) const {
+            return this->recognize(text.data(), text.length());
+        }
+
+        Recognition recognize(const std::string &text) const {
+            return this->recognize(
+                reinterpret_cast<const unsigned char*>(text.data()), text.length()
+            );
+        }
+
+        template <typename T>
+        Recognition recognize(const T *data, std::size_t length) const {
+            ExecutorContext context;
+
+            return this->recognize(context, data, length);
+        }
+
+        // Runs the program for its verdict only. Any program can be run this
+        // way, but one compiled with CompilerSettings::recognize skips the
+        // node bookkeeping altogether. The furthest failure is only reported
+        // by programs compiled with CompilerSettings::expect; otherwise the
+        // offset stays at the start and there are no expectations.
+        template <typename T>
+        Recognition recognize(ExecutorContext &context, const T *data, std::size_t length) const {
+            this->start(context);
+            this->run(context, Text<T>(data, length));
+
+            const auto matched = is_matched(context);
+
+            return {
+                matched, matched ? context.cursor : 0, context.offset, context.expectations.get_rules(),
+            };
+        }
+
+        void start(ExecutorContext &context, std::size_t entry = 0, std::size_t cursor = 0) const {
+            context.reset();
+            context.records.push_back({ NO_RULE, cursor, cursor, NO_NODE, NO_NODE });
+            context.node = { 0, NO_NODE };
+            context.cursor = cursor;
+            context.offset = cursor;
+            context.reach = cursor;
+            context.floor = cursor;
+            context.committed = 1;
+            context.splitting = false;
+            context.pruning = true;
+            invoke(context, entry);
+        }
+
+        static void invoke(ExecutorContext &context, std::size_t entry) {
+            context.stack.push_frame(context.frame);
+            context.frame = { 0, 1, 0 };
+            context.pointer = entry;
+        }
+
+        template <typename Input>
+        bool run(ExecutorContext &context, const Input &text) const {
+            const auto operations = this->program.operations.data();
+            auto pointer = context.pointer;
+
+            while (!context.stack.empty()) {
+                const auto &operation = operations[pointer];
+
+                if (!text.is_available(context.cursor, this->get_extent(operation))) {
+                    context.pointer = pointer;
+                    return false;
+                }
+
+                switch (operation.opcode) {
+                case Opcode::INVOKE:
+                    context.stack.push_frame(context.frame);
+                    context.frame = { operation.target, operation.failure, 0 };
+                    pointer = operation.first;
+                    break;
+                case Opcode::TAIL_INVOKE:
+                    context.records[context.node.index].rule = operation.second;
+                    context.frame.pending++;
+                    pointer = operation.first;
+                    break;
+                case Opcode::REVOKE_SUCCESS:
+                    pointer = revoke_success(context);
+                    break;
+                case Opcode::REVOKE_FAILURE:
+                    pointer = revoke_failure(context);
+                    break;
+                case Opcode::PREPARE: {
+                    auto index = context.records.size();
+                    context.records.push_back({
+                        NO_RULE, context.cursor, 0, NO_NODE, NO_NODE,
+                    });
+                    context.stack.push_node(context.node);
+                    context.node = { index, NO_NODE };
+                    pointer = operation.target;
+                    break;
+                }
+                case Opcode::CONSUME: {
+                    auto index = context.node.index;
+                    context.node = context.stack.pop_node();
+                    auto &record = context.records[index];
+                    record.rule = operation.first;
+                    record.stop = context.cursor;
+                    attach(context, index);
+                    pointer = operation.target;
+                    break;
+                }
+                case Opcode::SPLICE: {
+                    const auto node = context.node;
+                    context.node = context.stack.pop_node();
+                    const auto child = context.records[node.index].child;
+                    if (child != NO_NODE) {
+                        attach(context, child);
+                        context.node.last = node.last;
+                    }
+                    pointer = operation.target;
+                    break;
+                }
+                case Opcode::CONSUME_REVOKE: {
+                    auto index = context.node.index;
+                    context.node = context.stack.pop_node();
+                    auto &record = context.records[index];
+                    record.rule = operation.first;
+                    record.stop = context.cursor;
+                    attach(context, index);
+                    pointer = revoke_success(context);
+                    break;
+                }
+                case Opcode::DISCARD_REVOKE:
+                    context.records.resize(context.node.index);
+                    context.node = context.stack.pop_node();
+                    pointer = revoke_failure(context);
+                    break;
+                case Opcode::DISCARD:
+                    context.records.resize(context.node.index);
+                    context.node = context.stack.pop_node();
+                    pointer = operation.target;
+                    break;
+                case Opcode::BEGIN:
+                    context.stack.push_mark({ context.records.size(), context.node.last, context.cursor });
+                    pointer = operation.target;
+                    break;
+                case Opcode::COMMIT:
+                    context.stack.pop();
+                    pointer = operation.target;
+                    break;
+                case Opcode::ABORT: {
+                    const auto mark = context.stack.pop_mark();
+                    if (mark.last == NO_NODE) {
+                        context.records[context.node.index].child = NO_NODE;
+                    } else {
+                        context.records[mark.last].sibling = NO_NODE;
+                    }
+                    context.node.last = mark.last;
+                    context.records.resize(mark.size);
+                    context.cursor = mark.cursor;
+                    pointer = operation.target;
+                    break;
+                }
+                case Opcode::MATCH_LITERAL: {
+                    auto &cursor = context.cursor;
+                    const auto &literal = this->program.literals[operation.first];
+
+                    pointer = operation.failure;
+
+                    if (text.matches(cursor, literal)) {
+                        cursor += literal.length();
+                        pointer = operation.target;
+                    }
+                    break;
+                }
+                case Opcode::MATCH_RANGE: {
+                    auto &cursor = context.cursor;
+                    const auto code = text.at(cursor);
+
+                    pointer = operation.failure;
+
+                    if (operation.first <= code && code <= operation.second) {
+                        cursor++;
+                        pointer = operation.target;
+                    }
+                    break;
+                }
+                case Opcode::MATCH_SET: {
+                    auto &cursor = context.cursor;
+
+                    pointer = operation.failure;
+
+                    if (this->program.sets[operation.first].contains(text.at(cursor))) {
+                        cursor++;
+                        pointer = operation.target;
+                    }
+                    break;
+                }
+                case Opcode::MATCH_LITERAL_NODE: {
+                    auto &cursor = context.cursor;
+                    const auto &literal = this->program.literals[operation.first];
 
-        Node execute(const std::u32string &text) const {
-            ExecutorContext context = { text };
-            context.pointer = 0;
-            context.frames.push({ 0, 0 });
-            context.nodes.push({ {} });
-            context.cursors.push(0);
-            context.offset = 0;
+                    pointer = operation.failure;
 
-            while (!context.frames.empty()) {
-                auto &instruction = this->instructions[context.pointer];
+                    if (text.matches(cursor, literal)) {
+                        auto index = context.records.size();
+                        context.records.push_back({
+                            operation.second, cursor, cursor + literal.length(), NO_NODE, NO_NODE,
+                        });
+                        attach(context, index);
+                        cursor += literal.length();
+                        pointer = operation.target;
+                    }
+                    break;
+                }
+                case Opcode::MATCH_SET_NODE: {
+                    auto &cursor = context.cursor;
 
-                instruction->update(context);
+                    pointer = operation.failure;
+
+                    if (this->program.sets[operation.first].contains(text.at(cursor))) {
+                        auto index = context.records.size();
+                        context.records.push_back({
+                            operation.second, cursor, cursor + 1, NO_NODE, NO_NODE,
+                        });
+                        attach(context, index);
+                        cursor++;
+                        pointer = operation.target;
+                    }
+                    break;
+                }
+                case Opcode::MATCH_LITERAL_SET: {
+                    auto &cursor = context.cursor;
+                    std::size_t length;
+
+                    pointer = operation.failure;
+
+                    if (this->program.literal_sets[operation.first].match(text, cursor, length)) {
+                        cursor += length;
+                        pointer = operation.target;
+                    }
+                    break;
+                }
+                case Opcode::TEST_SET: {
+                    const auto code = text.at(context.cursor);
+
+                    if (this->program.sets[operation.first].contains(code)) {
+                        pointer = operation.target;
+                    } else {
+                        pointer = operation.failure;
+                    }
+                    break;
+                }
+                case Opcode::SPAN: {
+                    auto &cursor = context.cursor;
+                    cursor = text.span(cursor, this->program.sets[operation.first]);
+
+                    if (!text.is_available(cursor, 1)) {
+                        context.pointer = pointer;
+                        return false;
+                    }
+
+                    pointer = operation.target;
+                    break;
+                }
+                case Opcode::JUMP:
+                    pointer = operation.target;
+                    break;
+                case Opcode::CUT:
+                    context.floor = context.cursor;
+                    context.committed = context.records.size();
+                    if (context.pruning) {
+                        context.memos.erase(
+                            context.memos.begin(),
+                            context.memos.lower_bound({ context.floor, 0 })
+                        );
+                    }
+                    pointer = operation.target;
+                    break;
+                case Opcode::SPLIT:
+                    if (context.splitting) {
+                        context.pointer = pointer;
+                        return false;
+                    }
+                    pointer = operation.target;
+                    break;
+                case Opcode::EXPECT: {
+                    const auto cursor = context.cursor;
+                    if (cursor > context.offset) {
+                        context.expectations.clear();
+                        context.offset = cursor;
+                    }
+                    if (cursor == context.offset) {
+                        context.expectations.insert(operation.first);
+                    }
+                    pointer = operation.target;
+                    break;
+                }
+                case Opcode::RECALL: {
+                    auto &cursor = context.cursor;
+                    auto it = context.memos.find({ cursor, operation.first });
+
+                    if (it == context.memos.end()) {
+                        context.stack.push_recall({ context.reach, cursor, context.records.size() });
+                        context.reach = cursor;
+                        pointer = operation.second;
+                        break;
+                    }
+
+                    context.reach = std::max(context.reach, it->second.reach);
+
+                    if (it->second.success) {
+                        auto index = context.records.size();
+                        for (auto record: it->second.records) {
+                            record.start += cursor;
+                            record.stop += cursor;
+                            if (record.child != NO_NODE) {
+                                record.child += index;
+                            }
+                            if (record.sibling != NO_NODE) {
+                                record.sibling += index;
+                            }
+                            context.records.push_back(record);
+                        }
+                        if (index != context.records.size()) {
+                            attach(context, index);
+                        }
+                        cursor = it->second.stop;
+                        pointer = operation.target;
+                    } else {
+                        pointer = operation.failure;
+                    }
+                    break;
+                }
+                case Opcode::MEMOIZE_SUCCESS: {
+                    const auto recall = context.stack.pop_recall();
+                    const auto index = recall.size;
+                    Memo memo = { true, context.cursor, context.reach };
+                    for (auto it = context.records.begin() + index; it != context.records.end(); ++it) {
+                        auto record = *it;
+                        record.start -= recall.start;
+                        record.stop -= recall.start;
+                        if (record.child != NO_NODE) {
+                            record.child -= index;
+                        }
+                        if (record.sibling != NO_NODE) {
+                            record.sibling -= index;
+                        }
+                        memo.records.push_back(record);
+                    }
+                    context.memos.emplace(
+                        std::make_pair(recall.start, operation.first),
+                        std::move(memo)
+                    );
+                    restore_reach(context, recall);
+                    pointer = operation.target;
+                    break;
+                }
+                case Opcode::MEMOIZE_FAILURE: {
+                    const auto recall = context.stack.pop_recall();
+                    context.memos.emplace(
+                        std::make_pair(recall.start, operation.first),
+                        Memo { false, 0, context.reach }
+                    );
+                    restore_reach(context, recall);
+                    pointer = operation.target;
+                    break;
+                }
+                }
             }
 
-            return std::move(context.nodes.top());
+            context.pointer = pointer;
+
+            return true;
+        }
+
+        static bool is_matched(const ExecutorContext &context) {
+            return context.stack.empty() && context.pointer == 0;
+        }
+
+        const Program &get_program() const {
+            return this->program;
         }
     private:
-        const std::vector<std::shared_ptr<Instruction>> instructions;
+        std::size_t get_extent(const Operation &operation) const {
+            switch (operation.opcode) {
+            case Opcode::MATCH_LITERAL:
+            case Opcode::MATCH_LITERAL_NODE:
+                return this->program.literals[operation.first].length();
+            case Opcode::MATCH_LITERAL_SET:
+                return this->program.literal_sets[operation.first].get_length();
+            case Opcode::MATCH_RANGE:
+            case Opcode::MATCH_SET:
+            case Opcode::MATCH_SET_NODE:
+            case Opcode::TEST_SET:
+                return 1;
+            default:
+                return 0;
+            }
+        }
+
+        static void restore_reach(ExecutorContext &context, const Recall &recall) {
+            context.reach = std::max(context.reach, recall.reach);
+        }
+
+        static std::size_t revoke_success(ExecutorContext &context) {
+            const auto frame = context.frame;
+
+            for (std::size_t i = 0; i < frame.pending; i++) {
+                auto index = context.node.index;
+                context.node = context.stack.pop_node();
+                context.records[index].stop = context.cursor;
+                attach(context, index);
+            }
+
+            context.frame = context.stack.pop_frame();
+
+            return frame.success;
+        }
+
+        static std::size_t revoke_failure(ExecutorContext &context) {
+            const auto frame = context.frame;
+
+            if (frame.pending != 0) {
+                for (std::size_t i = 1; i < frame.pending; i++) {
+                    context.node = context.stack.pop_node();
+                }
+                // A tail call commits the caller's marks early, so the
+                // outermost node's start is what rewinds the cursor.
+                context.cursor = context.records[context.node.index].start;
+                context.records.resize(context.node.index);
+                context.node = context.stack.pop_node();
+            }
+
+            context.frame = context.stack.pop_frame();
+
+            return frame.failure;
+        }
+
+        static void attach(ExecutorContext &context, std::size_t index) {
+            auto &parent = context.node;
+
+            if (parent.last == NO_NODE) {
+                context.records[parent.index].child = index;
+            } else {
+                context.records[parent.last].sibling = index;
+            }
+
+            parent.last = index;
+        }
+
+        const Program program;
     };
 }
 
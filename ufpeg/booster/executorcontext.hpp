@@ -1,20 +1,45 @@
 #ifndef UFPEG_EXECUTOR_CONTEXT_HPP
 #define UFPEG_EXECUTOR_CONTEXT_HPP
 
-#include <stack>
+#include <cstdint>
+#include <vector>
+#include <map>
 
 #include "frame.hpp"
 #include "node.hpp"
+#include "opennode.hpp"
+#include "memo.hpp"
+#include "backtrackstack.hpp"
+#include "expectationset.hpp"
 
 namespace ufpeg {
+    // The innermost frame, open node and cursor live in their own fields;
+    // the stack only holds the values to go back to once they are done.
     struct ExecutorContext {
-        const std::u32string text;
-        std::size_t pointer;
-        std::stack<Frame> frames;
-        std::stack<Node> nodes;
-        std::stack<std::size_t> cursors;
-        std::vector<std::u32string> expectations;
+        ExecutorContext(const GrowthPolicy &policy = {}):
+            stack(policy) {}
+
+        std::vector<NodeRecord> records;
+        BacktrackStack stack;
+        Frame frame = { 0, 1, 0 };
+        OpenNode node = { 0, NO_NODE };
+        std::size_t cursor = 0;
+        ExpectationSet expectations;
         std::size_t offset;
+        std::size_t reach;
+        std::size_t pointer;
+        std::size_t floor;
+        std::size_t committed;
+        bool splitting;
+        bool pruning;
+        std::map<std::pair<std::size_t, std::size_t>, Memo> memos;
+
+        void reset() {
+            this->records.clear();
+            this->stack.clear();
+            this->expectations.clear();
+            this->memos.clear();
+        }
     };
 }
 
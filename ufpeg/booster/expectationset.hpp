@@ -0,0 +1,61 @@
+#ifndef UFPEG_EXPECTATION_SET_HPP
+#define UFPEG_EXPECTATION_SET_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace ufpeg {
+    // The rules that failed at the furthest offset, each one once. A flag
+    // per rule makes insert() a bit test, and clear() only resets the flags
+    // that are set, so moving the offset costs as much as what it drops.
+    class ExpectationSet {
+    public:
+        void insert(std::uint32_t rule) {
+            if (rule >= this->flags.size()) {
+                this->flags.resize(rule + 1);
+            }
+
+            if (!this->flags[rule]) {
+                this->flags[rule] = true;
+                this->rules.push_back(rule);
+            }
+        }
+
+        void clear() {
+            for (auto rule: this->rules) {
+                this->flags[rule] = false;
+            }
+
+            this->rules.clear();
+        }
+
+        bool contains(std::uint32_t rule) const {
+            return rule < this->flags.size() && this->flags[rule];
+        }
+
+        bool empty() const {
+            return this->rules.empty();
+        }
+
+        std::size_t size() const {
+            return this->rules.size();
+        }
+
+        const std::vector<std::uint32_t> &get_rules() const {
+            return this->rules;
+        }
+
+        std::vector<std::uint32_t>::const_iterator begin() const {
+            return this->rules.begin();
+        }
+
+        std::vector<std::uint32_t>::const_iterator end() const {
+            return this->rules.end();
+        }
+    private:
+        std::vector<bool> flags;
+        std::vector<std::uint32_t> rules;
+    };
+}
+
+#endif
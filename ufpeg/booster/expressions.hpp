@@ -6,6 +6,9 @@
 #include "instructions.hpp"
 #include "compilercontext.hpp"
 #include "compileoptions.hpp"
+#include "ruleoptions.hpp"
+#include "alternative.hpp"
+#include "utf8.hpp"
 
 namespace ufpeg {
     class Expression {
@@ -16,6 +19,58 @@ namespace ufpeg {
             CompilerContext &context,
             const CompileOptions &options
         ) const = 0;
+
+        virtual bool collect_ranges(const CompilerContext &context, CharacterRanges &ranges) const {
+            return false;
+        }
+
+        virtual bool collect_literals(const CompilerContext &context, std::vector<std::u32string> &literals) const {
+            return false;
+        }
+
+        virtual First get_first(const CompilerContext &context) const {
+            return { true, {} };
+        }
+
+        virtual bool analyze(CompilerContext &context) const {
+            return false;
+        }
+
+        virtual bool get_items(std::vector<std::shared_ptr<Expression>> &items) const {
+            return false;
+        }
+
+        virtual bool get_rule_name(std::u32string &name) const {
+            return false;
+        }
+
+        virtual bool get_definition_name(std::u32string &name) const {
+            return false;
+        }
+
+        virtual bool has_cut() const {
+            return false;
+        }
+
+        virtual bool is_equal(const Expression &other) const {
+            return this == &other;
+        }
+
+        virtual std::vector<std::shared_ptr<Expression>> get_children() const {
+            return {};
+        }
+    protected:
+        static bool are_equal(
+            const std::vector<std::shared_ptr<Expression>> &items,
+            const std::vector<std::shared_ptr<Expression>> &others
+        ) {
+            return std::equal(
+                items.begin(), items.end(), others.begin(), others.end(),
+                [](const std::shared_ptr<Expression> &item, const std::shared_ptr<Expression> &other) {
+                    return item->is_equal(*other);
+                }
+            );
+        }
     };
 
     class SequenceExpression: public Expression {
@@ -27,6 +82,16 @@ namespace ufpeg {
             CompilerContext &context,
             const CompileOptions &options
         ) const {
+            if (this->items.empty()) {
+                return {
+                    std::make_shared<JumpInstruction>(options.success, options.entry),
+                };
+            }
+
+            if (this->items.size() == 1) {
+                return this->items.front()->compile(context, options);
+            }
+
             auto commit = std::make_shared<CommitInstruction>(options.success);
             auto abort = std::make_shared<AbortInstruction>(options.failure);
 
@@ -34,10 +99,28 @@ namespace ufpeg {
 
             auto success = commit->get_reference();
             auto failure = abort->get_reference();
+            auto cut = failure;
+
+            if (this->has_cut()) {
+                auto abort_cut = std::make_shared<AbortInstruction>(
+                    options.cut ? options.cut : options.failure
+                );
+
+                instructions.insert(instructions.begin(), abort_cut);
+                cut = abort_cut->get_reference();
+            }
 
             for (auto it = this->items.rbegin(); it != this->items.rend(); ++it) {
                 auto entry = std::make_shared<Reference>();
-                auto item_instructions = (*it)->compile(context, { entry, success, failure });
+                const auto after_cut = std::any_of(
+                    std::next(it), this->items.rend(), [](const std::shared_ptr<Expression> &item) {
+                        return item->has_cut();
+                    }
+                );
+                auto item_instructions = (*it)->compile(context, {
+                    entry, success, after_cut ? cut : failure, cut,
+                    options.committed || (after_cut && options.global), options.global,
+                });
 
                 success = entry;
 
@@ -56,14 +139,187 @@ namespace ufpeg {
 
             return instructions;
         }
+
+        First get_first(const CompilerContext &context) const {
+            First first = { true, {} };
+
+            for (const auto &item: this->items) {
+                const auto item_first = item->get_first(context);
+
+                first.ranges.insert(first.ranges.end(), item_first.ranges.begin(), item_first.ranges.end());
+
+                if (!item_first.nullable) {
+                    first.nullable = false;
+                    break;
+                }
+            }
+
+            return first;
+        }
+
+        bool get_items(std::vector<std::shared_ptr<Expression>> &items) const {
+            items = this->items;
+
+            return true;
+        }
+
+        bool has_cut() const {
+            return std::any_of(
+                this->items.begin(), this->items.end(), [](const std::shared_ptr<Expression> &item) {
+                    return item->has_cut();
+                }
+            );
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const SequenceExpression*>(&other);
+
+            return expression && are_equal(this->items, expression->items);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return this->items;
+        }
     private:
         const std::vector<std::shared_ptr<Expression>> items;
     };
 
+    class CutExpression: public Expression {
+    public:
+        std::vector<std::shared_ptr<Instruction>> compile(
+            CompilerContext &context,
+            const CompileOptions &options
+        ) const {
+            if (options.global) {
+                return {
+                    std::make_shared<CutInstruction>(options.success, options.entry),
+                };
+            }
+
+            return {
+                std::make_shared<JumpInstruction>(options.success, options.entry),
+            };
+        }
+
+        bool has_cut() const {
+            return true;
+        }
+    };
+
+    class FactoredExpression: public Expression {
+    public:
+        FactoredExpression(const std::shared_ptr<Expression> &item, bool node):
+            item(item), node(node) {}
+
+        std::vector<std::shared_ptr<Instruction>> compile(
+            CompilerContext &context,
+            const CompileOptions &options
+        ) const {
+            if (!this->node) {
+                return this->item->compile(context, options);
+            }
+
+            auto entry = std::make_shared<Reference>();
+
+            auto prepare = std::make_shared<PrepareInstruction>(entry, options.entry);
+            auto discard = std::make_shared<DiscardInstruction>(options.failure);
+
+            auto instructions = this->item->compile(
+                context, { entry, options.success, discard->get_reference() }
+            );
+
+            instructions.emplace(instructions.begin(), prepare);
+            instructions.emplace_back(discard);
+
+            return instructions;
+        }
+
+        First get_first(const CompilerContext &context) const {
+            return this->item->get_first(context);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
+    private:
+        const std::shared_ptr<Expression> item;
+        const bool node;
+    };
+
+    class ConsumeExpression: public Expression {
+    public:
+        ConsumeExpression(const std::u32string &name):
+            name(name) {}
+
+        std::vector<std::shared_ptr<Instruction>> compile(
+            CompilerContext &context,
+            const CompileOptions &options
+        ) const {
+            const auto rule = context.symbols.intern(this->name);
+
+            return {
+                std::make_shared<ConsumeInstruction>(rule, options.success, options.entry),
+            };
+        }
+    private:
+        const std::u32string name;
+    };
+
+    class SpliceExpression: public Expression {
+    public:
+        std::vector<std::shared_ptr<Instruction>> compile(
+            CompilerContext &context,
+            const CompileOptions &options
+        ) const {
+            return {
+                std::make_shared<SpliceInstruction>(options.success, options.entry),
+            };
+        }
+    };
+
+    class NodeExpression: public Expression {
+    public:
+        NodeExpression(const std::u32string &name, const std::shared_ptr<Expression> &item):
+            name(name), item(item) {}
+
+        std::vector<std::shared_ptr<Instruction>> compile(
+            CompilerContext &context,
+            const CompileOptions &options
+        ) const {
+            const auto rule = context.symbols.intern(this->name);
+            auto entry = std::make_shared<Reference>();
+
+            auto prepare = std::make_shared<PrepareInstruction>(entry, options.entry);
+            auto consume = std::make_shared<ConsumeInstruction>(rule, options.success);
+            auto discard = std::make_shared<DiscardInstruction>(options.failure);
+
+            auto instructions = this->item->compile(context, {
+                entry, consume->get_reference(), discard->get_reference(),
+                discard->get_reference(), options.committed, options.committed,
+            });
+
+            instructions.emplace(instructions.begin(), prepare);
+            instructions.insert(instructions.end(), { consume, discard });
+
+            return instructions;
+        }
+
+        First get_first(const CompilerContext &context) const {
+            return this->item->get_first(context);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
+    private:
+        const std::u32string name;
+        const std::shared_ptr<Expression> item;
+    };
+
     class ChoiceExpression: public Expression {
     public:
-        ChoiceExpression(const std::vector<std::shared_ptr<Expression>> &items):
-            items(items) {}
+        ChoiceExpression(const std::vector<std::shared_ptr<Expression>> &items, bool inlining = true):
+            items(items), inlining(inlining) {}
 
         std::vector<std::shared_ptr<Instruction>> compile(
             CompilerContext &context,
@@ -75,15 +331,65 @@ namespace ufpeg {
                 };
             }
 
+            CharacterRanges ranges;
+
+            if (
+                this->items.size() > 1 && this->collect_ranges(context, ranges) &&
+                (!context.settings.utf8 || is_ascii(ranges))
+            ) {
+                return {
+                    std::make_shared<MatchSetInstruction>(
+                        ranges, options.success, options.failure, options.entry
+                    ),
+                };
+            }
+
+            std::vector<std::u32string> literals;
+
+            if (this->items.size() > 1 && this->collect_literals(context, literals)) {
+                if (context.settings.utf8) {
+                    for (auto &literal: literals) {
+                        literal = encode_utf8(literal);
+                    }
+                }
+
+                return {
+                    std::make_shared<MatchLiteralSetInstruction>(
+                        literals, options.success, options.failure, options.entry
+                    ),
+                };
+            }
+
+            auto items = this->group_literals(
+                context, context.settings.factor ? this->factor(context) : this->items
+            );
+
+            if (context.settings.cut) {
+                items = infer_cuts(context, items);
+            }
+
             std::vector<std::shared_ptr<Instruction>> instructions;
 
             auto success = options.success;
             auto failure = options.failure;
 
-            for (auto it = this->items.rbegin(); it != this->items.rend(); ++it) {
-                auto entry = std::next(it) == this->items.rend() ?
+            for (auto it = items.rbegin(); it != items.rend(); ++it) {
+                auto entry = std::next(it) == items.rend() ?
                     options.entry : std::make_shared<Reference>();
-                auto item_instructions = (*it)->compile(context, { entry, success, failure });
+                auto start = entry;
+
+                const auto first = (*it)->get_first(context);
+                std::shared_ptr<Instruction> guard;
+
+                if (!first.nullable && !is_terminal(context, *it)) {
+                    start = std::make_shared<Reference>();
+                    guard = std::make_shared<TestSetInstruction>(first.ranges, start, failure, entry);
+                }
+
+                auto item_instructions = (*it)->compile(context, {
+                    start, success, failure, options.failure,
+                    options.committed && it == items.rbegin(), options.committed,
+                });
 
                 failure = entry;
 
@@ -92,14 +398,273 @@ namespace ufpeg {
                     item_instructions.rbegin(),
                     item_instructions.rend()
                 );
+
+                if (guard) {
+                    instructions.emplace_back(guard);
+                }
             }
 
             std::reverse(instructions.begin(), instructions.end());
 
             return instructions;
         }
+
+        bool collect_ranges(const CompilerContext &context, CharacterRanges &ranges) const {
+            for (const auto &item: this->items) {
+                if (!item->collect_ranges(context, ranges)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool collect_literals(const CompilerContext &context, std::vector<std::u32string> &literals) const {
+            for (const auto &item: this->items) {
+                if (!item->collect_literals(context, literals)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        First get_first(const CompilerContext &context) const {
+            First first = { false, {} };
+
+            for (const auto &item: this->items) {
+                const auto item_first = item->get_first(context);
+
+                first.nullable = first.nullable || item_first.nullable;
+                first.ranges.insert(first.ranges.end(), item_first.ranges.begin(), item_first.ranges.end());
+            }
+
+            return first;
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const ChoiceExpression*>(&other);
+
+            return expression && are_equal(this->items, expression->items);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return this->items;
+        }
     private:
+        static bool is_terminal(const CompilerContext &context, const std::shared_ptr<Expression> &item) {
+            CharacterRanges ranges;
+            std::vector<std::u32string> literals;
+
+            return item->collect_ranges(context, ranges) || item->collect_literals(context, literals);
+        }
+
+        std::vector<Alternative> get_alternatives(
+            const CompilerContext &context,
+            const std::shared_ptr<Expression> &item
+        ) const {
+            std::vector<Alternative> alternatives(1);
+
+            if (!item->get_items(alternatives.front().items)) {
+                alternatives.front().items = { item };
+            }
+
+            std::u32string name;
+
+            if (this->inlining && item->get_rule_name(name)) {
+                const auto definition = context.get_definition(context.symbols.find(name));
+
+                const auto memoize = definition.options.memoize || context.settings.memoize;
+
+                if (definition.item && (!definition.options.node || !memoize)) {
+                    Alternative alternative = { context.has_node(definition) ? name : U"", {} };
+
+                    if (!definition.item->get_items(alternative.items)) {
+                        alternative.items = { definition.item };
+                    }
+
+                    alternatives.emplace_back(alternative);
+                }
+            }
+
+            return alternatives;
+        }
+
+        std::vector<std::shared_ptr<Expression>> factor(const CompilerContext &context) const {
+            std::vector<std::vector<Alternative>> candidates;
+
+            for (const auto &item: this->items) {
+                candidates.emplace_back(this->get_alternatives(context, item));
+            }
+
+            std::vector<std::shared_ptr<Expression>> items;
+
+            for (std::size_t i = 0; i < candidates.size();) {
+                std::vector<Alternative> group;
+
+                for (const auto &alternative: candidates[i]) {
+                    if (alternative.items.empty() || contains_cut(alternative.items)) {
+                        continue;
+                    }
+
+                    std::vector<Alternative> current = { alternative };
+
+                    for (auto j = i + 1; j < candidates.size(); j++) {
+                        auto it = std::find_if(
+                            candidates[j].begin(), candidates[j].end(),
+                            [&alternative](const Alternative &other) {
+                                return !other.items.empty() && !contains_cut(other.items) &&
+                                    other.items.front()->is_equal(*alternative.items.front());
+                            }
+                        );
+
+                        if (it == candidates[j].end()) {
+                            break;
+                        }
+
+                        current.emplace_back(*it);
+                    }
+
+                    if (current.size() > group.size()) {
+                        group = current;
+                    }
+                }
+
+                if (group.size() > 1) {
+                    items.emplace_back(this->factor_group(group));
+                    i += group.size();
+                } else {
+                    items.emplace_back(this->items[i]);
+                    i++;
+                }
+            }
+
+            return items;
+        }
+
+        std::shared_ptr<Expression> factor_group(const std::vector<Alternative> &group) const {
+            const auto &front = group.front().items;
+            auto length = front.size();
+
+            for (const auto &alternative: group) {
+                std::size_t i = 0;
+
+                while (i < length && i < alternative.items.size() && alternative.items[i]->is_equal(*front[i])) {
+                    i++;
+                }
+
+                length = i;
+            }
+
+            const auto node = std::any_of(
+                group.begin(), group.end(), [](const Alternative &alternative) {
+                    return !alternative.rule.empty();
+                }
+            );
+
+            std::vector<std::shared_ptr<Expression>> branches;
+
+            for (const auto &alternative: group) {
+                std::vector<std::shared_ptr<Expression>> rest(
+                    alternative.items.begin() + length, alternative.items.end()
+                );
+
+                if (node && alternative.rule.empty()) {
+                    rest.emplace_back(std::make_shared<SpliceExpression>());
+                } else if (node) {
+                    rest.emplace_back(std::make_shared<ConsumeExpression>(alternative.rule));
+                }
+
+                if (rest.size() == 1) {
+                    branches.emplace_back(rest.front());
+                } else {
+                    branches.emplace_back(std::make_shared<SequenceExpression>(rest));
+                }
+            }
+
+            std::vector<std::shared_ptr<Expression>> items(front.begin(), front.begin() + length);
+            items.emplace_back(std::make_shared<ChoiceExpression>(branches, false));
+
+            return std::make_shared<FactoredExpression>(
+                std::make_shared<SequenceExpression>(items), node
+            );
+        }
+
+        static bool contains_cut(const std::vector<std::shared_ptr<Expression>> &items) {
+            return std::any_of(
+                items.begin(), items.end(), [](const std::shared_ptr<Expression> &item) {
+                    return item->has_cut();
+                }
+            );
+        }
+
+        static std::vector<std::shared_ptr<Expression>> infer_cuts(
+            const CompilerContext &context,
+            const std::vector<std::shared_ptr<Expression>> &choices
+        ) {
+            auto items = choices;
+
+            for (std::size_t i = 0; i + 1 < items.size(); i++) {
+                std::vector<std::shared_ptr<Expression>> sequence;
+
+                if (!items[i]->get_items(sequence) || sequence.size() < 2 || contains_cut(sequence)) {
+                    continue;
+                }
+
+                const auto first = sequence.front()->get_first(context);
+
+                const auto disjoint = !first.nullable && std::all_of(
+                    items.begin() + i + 1, items.end(), [&context, &first](const std::shared_ptr<Expression> &item) {
+                        const auto other = item->get_first(context);
+
+                        return !other.nullable && !overlaps(first.ranges, other.ranges);
+                    }
+                );
+
+                if (disjoint) {
+                    sequence.insert(sequence.begin() + 1, std::make_shared<CutExpression>());
+                    items[i] = std::make_shared<SequenceExpression>(sequence);
+                }
+            }
+
+            return items;
+        }
+
+        static std::vector<std::shared_ptr<Expression>> group_literals(
+            const CompilerContext &context,
+            const std::vector<std::shared_ptr<Expression>> &choices
+        ) {
+            std::vector<std::shared_ptr<Expression>> items, run;
+
+            for (const auto &item: choices) {
+                std::vector<std::u32string> literals;
+
+                if (item->collect_literals(context, literals)) {
+                    run.push_back(item);
+                    continue;
+                }
+
+                if (run.size() > 1) {
+                    items.push_back(std::make_shared<ChoiceExpression>(run));
+                } else {
+                    items.insert(items.end(), run.begin(), run.end());
+                }
+
+                items.push_back(item);
+                run.clear();
+            }
+
+            if (run.size() > 1) {
+                items.push_back(std::make_shared<ChoiceExpression>(run));
+            } else {
+                items.insert(items.end(), run.begin(), run.end());
+            }
+
+            return items;
+        }
+
         const std::vector<std::shared_ptr<Expression>> items;
+        const bool inlining;
     };
 
     class LiteralExpression: public Expression {
@@ -113,12 +678,75 @@ namespace ufpeg {
         ) const {
             return {
                 std::make_shared<MatchLiteralInstruction>(
-                    this->literal, options.success, options.failure, options.entry
+                    context.settings.utf8 ? encode_utf8(this->literal) : this->literal,
+                    options.success, options.failure, options.entry
                 ),
             };
         }
+
+        bool collect_ranges(const CompilerContext &context, CharacterRanges &ranges) const {
+            if (this->literal.length() != 1) {
+                return false;
+            }
+
+            ranges.emplace_back(this->literal.front(), this->literal.front());
+
+            return true;
+        }
+
+        bool collect_literals(const CompilerContext &context, std::vector<std::u32string> &literals) const {
+            literals.push_back(this->literal);
+
+            return true;
+        }
+
+        First get_first(const CompilerContext &context) const {
+            if (this->literal.empty()) {
+                return { true, {} };
+            }
+
+            const auto code = context.settings.utf8 ?
+                encode_utf8(this->literal.front()).front() : this->literal.front();
+
+            return { false, { { code, code } } };
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const LiteralExpression*>(&other);
+
+            return expression && this->literal == expression->literal;
+        }
+    private:
+        const std::u32string literal;
+    };
+
+    class ByteRangeExpression: public Expression {
+    public:
+        ByteRangeExpression(char32_t min, char32_t max):
+            min(min), max(max) {}
+
+        std::vector<std::shared_ptr<Instruction>> compile(
+            CompilerContext &context,
+            const CompileOptions &options
+        ) const {
+            return {
+                std::make_shared<MatchRangeInstruction>(
+                    this->min, this->max, options.success, options.failure, options.entry
+                ),
+            };
+        }
+
+        First get_first(const CompilerContext &context) const {
+            return { false, { { this->min, this->max } } };
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const ByteRangeExpression*>(&other);
+
+            return expression && this->min == expression->min && this->max == expression->max;
+        }
     private:
-        const std::u32string literal;
+        const char32_t min, max;
     };
 
     class RangeExpression: public Expression {
@@ -130,11 +758,60 @@ namespace ufpeg {
             CompilerContext &context,
             const CompileOptions &options
         ) const {
-            return {
-                std::make_shared<MatchRangeInstruction>(
-                    this->min, this->max, options.success, options.failure, options.entry
-                ),
-            };
+            if (!context.settings.utf8) {
+                return {
+                    std::make_shared<MatchRangeInstruction>(
+                        this->min, this->max, options.success, options.failure, options.entry
+                    ),
+                };
+            }
+
+            std::vector<ByteRanges> sequences;
+            split_utf8(this->min, this->max, sequences);
+
+            std::vector<std::shared_ptr<Expression>> choices;
+
+            for (const auto &sequence: sequences) {
+                std::vector<std::shared_ptr<Expression>> items;
+
+                for (const auto &range: sequence) {
+                    items.emplace_back(
+                        std::make_shared<ByteRangeExpression>(range.first, range.second)
+                    );
+                }
+
+                if (items.size() == 1) {
+                    choices.emplace_back(items.front());
+                } else {
+                    choices.emplace_back(std::make_shared<SequenceExpression>(items));
+                }
+            }
+
+            ChoiceExpression expression(choices);
+
+            return expression.compile(context, options);
+        }
+
+        bool collect_ranges(const CompilerContext &context, CharacterRanges &ranges) const {
+            ranges.emplace_back(this->min, this->max);
+
+            return true;
+        }
+
+        First get_first(const CompilerContext &context) const {
+            if (context.settings.utf8) {
+                return {
+                    false, { { encode_utf8(this->min).front(), encode_utf8(this->max).front() } },
+                };
+            }
+
+            return { false, { { this->min, this->max } } };
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const RangeExpression*>(&other);
+
+            return expression && this->min == expression->min && this->max == expression->max;
         }
     private:
         const char32_t min, max;
@@ -151,8 +828,23 @@ namespace ufpeg {
         ) const {
             return this->item->compile(context, {
                 options.entry, options.success, options.success,
+                options.failure, false, options.committed,
             });
         }
+
+        First get_first(const CompilerContext &context) const {
+            return { true, this->item->get_first(context).ranges };
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const ZeroOrOneExpression*>(&other);
+
+            return expression && this->item->is_equal(*expression->item);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
     private:
         const std::shared_ptr<Expression> item;
     };
@@ -166,7 +858,47 @@ namespace ufpeg {
             CompilerContext &context,
             const CompileOptions &options
         ) const {
-            return this->item->compile(context, { options.entry, options.entry, options.success });
+            CharacterRanges ranges;
+
+            if (this->item->collect_ranges(context, ranges) && (!context.settings.utf8 || is_ascii(ranges))) {
+                return {
+                    std::make_shared<SpanInstruction>(ranges, options.success, options.entry),
+                };
+            }
+
+            if (!this->item->has_cut()) {
+                return this->item->compile(context, { options.entry, options.entry, options.success });
+            }
+
+            auto entry = std::make_shared<Reference>();
+
+            auto begin = std::make_shared<BeginInstruction>(entry, options.entry);
+            auto commit = std::make_shared<CommitInstruction>(options.success);
+            auto abort = std::make_shared<AbortInstruction>(options.failure);
+
+            auto instructions = this->item->compile(context, {
+                entry, entry, commit->get_reference(),
+                abort->get_reference(), false, options.committed,
+            });
+
+            instructions.emplace(instructions.begin(), begin);
+            instructions.insert(instructions.end(), { commit, abort });
+
+            return instructions;
+        }
+
+        First get_first(const CompilerContext &context) const {
+            return { true, this->item->get_first(context).ranges };
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const ZeroOrMoreExpression*>(&other);
+
+            return expression && this->item->is_equal(*expression->item);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
         }
     private:
         const std::shared_ptr<Expression> item;
@@ -188,6 +920,24 @@ namespace ufpeg {
 
             return expression.compile(context, options);
         }
+
+        First get_first(const CompilerContext &context) const {
+            return this->item->get_first(context);
+        }
+
+        bool has_cut() const {
+            return this->item->has_cut();
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const OneOrMoreExpression*>(&other);
+
+            return expression && this->item->is_equal(*expression->item);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
     private:
         const std::shared_ptr<Expression> item;
     };
@@ -208,11 +958,105 @@ namespace ufpeg {
 
             return expression.compile(context, options);
         }
+
+        First get_first(const CompilerContext &context) const {
+            if (!this->count) {
+                return { true, {} };
+            }
+
+            return this->item->get_first(context);
+        }
+
+        bool has_cut() const {
+            return this->count && this->item->has_cut();
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const RepeatExpression*>(&other);
+
+            return expression && this->count == expression->count && this->item->is_equal(*expression->item);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
     private:
         const std::shared_ptr<Expression> item;
         const std::size_t count;
     };
 
+    class SplitExpression: public Expression {
+    public:
+        SplitExpression(const std::shared_ptr<Expression> &item, const std::shared_ptr<Expression> &resync):
+            item(item), resync(resync) {}
+
+        std::vector<std::shared_ptr<Instruction>> compile(
+            CompilerContext &context,
+            const CompileOptions &options
+        ) const {
+            auto loop = std::make_shared<Reference>();
+            auto item = std::make_shared<Reference>();
+            auto resync = std::make_shared<Reference>();
+
+            ZeroOrMoreExpression expression(this->item);
+
+            auto instructions = expression.compile(context, {
+                loop, options.success, options.failure,
+                options.cut, options.committed, options.global,
+            });
+
+            instructions.emplace(
+                instructions.begin(),
+                std::make_shared<SplitInstruction>(loop, item, resync, options.entry)
+            );
+
+            auto item_instructions = compile_subroutine(context, this->item, item);
+            auto resync_instructions = compile_subroutine(context, this->resync, resync);
+
+            instructions.insert(instructions.end(), item_instructions.begin(), item_instructions.end());
+            instructions.insert(instructions.end(), resync_instructions.begin(), resync_instructions.end());
+
+            return instructions;
+        }
+
+        First get_first(const CompilerContext &context) const {
+            return { true, this->item->get_first(context).ranges };
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const SplitExpression*>(&other);
+
+            return expression && this->item->is_equal(*expression->item) &&
+                this->resync->is_equal(*expression->resync);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item, this->resync };
+        }
+    private:
+        static std::vector<std::shared_ptr<Instruction>> compile_subroutine(
+            CompilerContext &context,
+            const std::shared_ptr<Expression> &expression,
+            const std::shared_ptr<Reference> &entry
+        ) {
+            auto revoke_success = std::make_shared<RevokeSuccessInstruction>();
+            auto revoke_failure = std::make_shared<RevokeFailureInstruction>();
+
+            auto instructions = expression->compile(context, {
+                entry,
+                revoke_success->get_reference(),
+                revoke_failure->get_reference(),
+                revoke_failure->get_reference(),
+            });
+
+            instructions.insert(instructions.end(), { revoke_success, revoke_failure });
+
+            return instructions;
+        }
+
+        const std::shared_ptr<Expression> item, resync;
+    };
+
     class AndExpression: public Expression {
     public:
         AndExpression(const std::shared_ptr<Expression> &item):
@@ -224,24 +1068,38 @@ namespace ufpeg {
         ) const {
             auto entry = std::make_shared<Reference>();
 
-            auto prepare = std::make_shared<PrepareInstruction>(entry, options.entry);
-            auto discard_success = std::make_shared<DiscardInstruction>(options.success);
-            auto discard_failure = std::make_shared<DiscardInstruction>(options.failure);
+            auto begin = std::make_shared<BeginInstruction>(entry, options.entry);
+            auto abort_success = std::make_shared<AbortInstruction>(options.success);
+            auto abort_failure = std::make_shared<AbortInstruction>(options.failure);
 
             auto instructions = this->item->compile(
                 context, {
                     entry,
-                    discard_success->get_reference(),
-                    discard_failure->get_reference(),
+                    abort_success->get_reference(),
+                    abort_failure->get_reference(),
                 }
             );
 
-            instructions.emplace(instructions.begin(), prepare);
-            instructions.emplace_back(discard_success);
-            instructions.emplace_back(discard_failure);
+            instructions.emplace(instructions.begin(), begin);
+            instructions.emplace_back(abort_success);
+            instructions.emplace_back(abort_failure);
 
             return instructions;
         }
+
+        First get_first(const CompilerContext &context) const {
+            return this->item->get_first(context);
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const AndExpression*>(&other);
+
+            return expression && this->item->is_equal(*expression->item);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
     private:
         const std::shared_ptr<Expression> item;
     };
@@ -257,24 +1115,38 @@ namespace ufpeg {
         ) const {
             auto entry = std::make_shared<Reference>();
 
-            auto prepare = std::make_shared<PrepareInstruction>(entry, options.entry);
-            auto discard_success = std::make_shared<DiscardInstruction>(options.success);
-            auto discard_failure = std::make_shared<DiscardInstruction>(options.failure);
+            auto begin = std::make_shared<BeginInstruction>(entry, options.entry);
+            auto abort_success = std::make_shared<AbortInstruction>(options.success);
+            auto abort_failure = std::make_shared<AbortInstruction>(options.failure);
 
             auto instructions = this->item->compile(
                 context, {
                     entry,
-                    discard_failure->get_reference(),
-                    discard_success->get_reference(),
+                    abort_failure->get_reference(),
+                    abort_success->get_reference(),
                 }
             );
 
-            instructions.emplace(instructions.begin(), prepare);
-            instructions.emplace_back(discard_failure);
-            instructions.emplace_back(discard_success);
+            instructions.emplace(instructions.begin(), begin);
+            instructions.emplace_back(abort_failure);
+            instructions.emplace_back(abort_success);
 
             return instructions;
         }
+
+        First get_first(const CompilerContext &context) const {
+            return { true, {} };
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const NotExpression*>(&other);
+
+            return expression && this->item->is_equal(*expression->item);
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
     private:
         const std::shared_ptr<Expression> item;
     };
@@ -288,22 +1160,94 @@ namespace ufpeg {
             CompilerContext &context,
             const CompileOptions &options
         ) const {
-            std::shared_ptr<Reference> target;
+            const auto rule = context.symbols.intern(this->name);
+            const auto definition = context.get_definition(rule);
+
+            if (is_inlined(context, definition)) {
+                auto inlined = options;
+                std::vector<std::shared_ptr<Instruction>> instructions;
+
+                if (context.settings.expect) {
+                    auto expect = std::make_shared<ExpectInstruction>(rule, options.failure);
+
+                    instructions.emplace_back(expect);
+
+                    inlined.failure = expect->get_reference();
+                }
+
+                std::vector<std::shared_ptr<Instruction>> item_instructions;
 
-            try {
-                target = context.references.at(this->name);
-            } catch (const std::out_of_range&) {
-                target = std::make_shared<Reference>();
-                context.references.emplace(this->name, target);
+                if (!context.has_node(definition)) {
+                    item_instructions = definition.item->compile(context, {
+                        inlined.entry, inlined.success, inlined.failure,
+                        inlined.failure, options.committed, options.committed,
+                    });
+                } else {
+                    NodeExpression expression(this->name, definition.item);
+
+                    item_instructions = expression.compile(context, inlined);
+                }
+
+                instructions.insert(instructions.begin(), item_instructions.begin(), item_instructions.end());
+
+                return instructions;
             }
 
+            auto target = context.get_reference(rule);
+
             return {
                 std::make_shared<InvokeInstruction>(
                     target, options.success, options.failure, options.entry
                 ),
             };
         }
+
+        First get_first(const CompilerContext &context) const {
+            return context.get_first(context.symbols.find(this->name));
+        }
+
+        bool get_rule_name(std::u32string &name) const {
+            name = this->name;
+
+            return true;
+        }
+
+        bool collect_ranges(const CompilerContext &context, CharacterRanges &ranges) const {
+            const auto definition = context.get_definition(context.symbols.find(this->name));
+
+            return is_flat(context, definition) && definition.item->collect_ranges(context, ranges);
+        }
+
+        bool collect_literals(const CompilerContext &context, std::vector<std::u32string> &literals) const {
+            const auto definition = context.get_definition(context.symbols.find(this->name));
+
+            return is_flat(context, definition) && definition.item->collect_literals(context, literals);
+        }
+
+        bool is_equal(const Expression &other) const {
+            auto expression = dynamic_cast<const RuleReferenceExpression*>(&other);
+
+            return expression && this->name == expression->name;
+        }
     private:
+        // Folding a node rule into its caller's set is only safe when it
+        // builds no node and is not expected to report its own failure.
+        static bool is_flat(const CompilerContext &context, const Definition &definition) {
+            const auto node = context.settings.expect ? definition.options.node : context.has_node(definition);
+            const auto memoize = definition.options.node &&
+                (definition.options.memoize || context.settings.memoize);
+
+            return definition.item && !node && !memoize && !definition.recursive;
+        }
+
+        static bool is_inlined(const CompilerContext &context, const Definition &definition) {
+            const auto memoize = definition.options.memoize || context.settings.memoize;
+
+            return definition.item && !definition.recursive &&
+                (!definition.options.node || !memoize) &&
+                definition.size <= context.settings.inline_limit;
+        }
+
         const std::u32string name;
     };
 
@@ -311,51 +1255,130 @@ namespace ufpeg {
     public:
         RuleDefinitionExpression(
             const std::u32string &name,
-            const std::shared_ptr<Expression> &item
+            const std::shared_ptr<Expression> &item,
+            const RuleOptions &options = {}
         ):
-            name(name), item(item) {}
+            name(name), item(item), options(options) {}
 
         std::vector<std::shared_ptr<Instruction>> compile(
             CompilerContext &context,
             const CompileOptions &options
         ) const {
-            std::shared_ptr<Reference> entry;
-
-            try {
-                entry = context.references.at(this->name);
-            } catch (const std::out_of_range&) {
-                entry = std::make_shared<Reference>();
-                context.references.emplace(this->name, entry);
-            }
+            const auto rule = context.symbols.intern(this->name);
+            auto entry = context.get_reference(rule);
 
-            auto target = std::make_shared<Reference>();
+            const auto committed = options.committed && !context.get_definition(rule).recursive;
 
-            auto prepare = std::make_shared<PrepareInstruction>(target, entry);
             auto revoke_success = std::make_shared<RevokeSuccessInstruction>();
             auto revoke_failure = std::make_shared<RevokeFailureInstruction>();
-            auto consume = std::make_shared<ConsumeInstruction>(
-                this->name, revoke_success->get_reference()
-            );
-            auto discard = std::make_shared<DiscardInstruction>(revoke_failure->get_reference());
+
+            std::vector<std::shared_ptr<Instruction>> prologue;
+            std::vector<std::shared_ptr<Instruction>> epilogue = {
+                revoke_success, revoke_failure,
+            };
+
+            auto start = entry;
+            auto success = revoke_success->get_reference();
+            auto failure = revoke_failure->get_reference();
+
+            if (context.settings.expect) {
+                auto expect = std::make_shared<ExpectInstruction>(rule, failure);
+
+                epilogue.insert(epilogue.begin(), expect);
+
+                failure = expect->get_reference();
+            }
+
+            if (!this->options.node) {
+                auto instructions = this->item->compile(
+                    context, {
+                        entry,
+                        success,
+                        failure,
+                        failure,
+                        committed,
+                        committed,
+                    }
+                );
+
+                instructions.insert(instructions.end(), epilogue.begin(), epilogue.end());
+
+                return instructions;
+            }
+
+            if (this->options.memoize || context.settings.memoize) {
+                start = std::make_shared<Reference>();
+
+                auto recall = std::make_shared<RecallInstruction>(
+                    rule, start, success, failure, entry
+                );
+                auto memoize_success = std::make_shared<MemoizeSuccessInstruction>(rule, success);
+                auto memoize_failure = std::make_shared<MemoizeFailureInstruction>(rule, failure);
+
+                prologue.emplace_back(recall);
+                epilogue.insert(epilogue.begin(), { memoize_success, memoize_failure });
+
+                success = memoize_success->get_reference();
+                failure = memoize_failure->get_reference();
+            }
+
+            if (!context.settings.recognize) {
+                auto target = std::make_shared<Reference>();
+
+                auto prepare = std::make_shared<PrepareInstruction>(target, start);
+                auto consume = std::make_shared<ConsumeInstruction>(rule, success);
+                auto discard = std::make_shared<DiscardInstruction>(failure);
+
+                prologue.emplace_back(prepare);
+                epilogue.insert(epilogue.begin(), { consume, discard });
+
+                start = target;
+                success = consume->get_reference();
+                failure = discard->get_reference();
+            }
 
             auto instructions = this->item->compile(
                 context, {
-                    target,
-                    consume->get_reference(),
-                    discard->get_reference(),
+                    start,
+                    success,
+                    failure,
+                    failure,
+                    committed,
+                    committed,
                 }
             );
 
-            instructions.emplace(instructions.begin(), prepare);
-            instructions.insert(instructions.end(), {
-                consume, discard, revoke_success, revoke_failure,
-            });
+            instructions.insert(instructions.begin(), prologue.begin(), prologue.end());
+            instructions.insert(instructions.end(), epilogue.begin(), epilogue.end());
 
             return instructions;
         }
+
+        First get_first(const CompilerContext &context) const {
+            return this->item->get_first(context);
+        }
+
+        bool analyze(CompilerContext &context) const {
+            const auto rule = context.symbols.intern(this->name);
+
+            context.set_definition(rule, { this->item, this->options });
+
+            return context.set_first(rule, this->item->get_first(context));
+        }
+
+        bool get_definition_name(std::u32string &name) const {
+            name = this->name;
+
+            return true;
+        }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return { this->item };
+        }
     private:
         const std::u32string name;
         const std::shared_ptr<Expression> item;
+        const RuleOptions options;
     };
 
     class GrammarExpression: public Expression {
@@ -367,10 +1390,43 @@ namespace ufpeg {
             CompilerContext &context,
             const CompileOptions &options
         ) const {
+            for (auto changed = true; changed;) {
+                changed = false;
+
+                for (const auto &item: this->items) {
+                    changed = item->analyze(context) || changed;
+                }
+            }
+
+            for (std::uint32_t rule = 0; rule < context.definitions.size(); rule++) {
+                if (context.definitions[rule].item) {
+                    context.definitions[rule].recursive = is_recursive(context, rule);
+                }
+            }
+
+            for (auto &definition: context.definitions) {
+                if (definition.item && !definition.size) {
+                    definition.size = get_size(context, definition.item);
+                }
+            }
+
+            std::u32string name;
+
+            if (!this->items.empty() && this->items.front()->get_definition_name(name)) {
+                const auto rule = context.symbols.find(name);
+
+                if (context.has_node(context.get_definition(rule))) {
+                    context.start = rule;
+                }
+            }
+
             std::vector<std::shared_ptr<Instruction>> instructions;
 
             for (auto it = this->items.begin(); it != this->items.end(); ++it) {
-                auto item_instructions = (*it)->compile(context, {});
+                CompileOptions item_options;
+                item_options.committed = it == this->items.begin();
+
+                auto item_instructions = (*it)->compile(context, item_options);
 
                 instructions.insert(
                     instructions.end(),
@@ -381,7 +1437,75 @@ namespace ufpeg {
 
             return instructions;
         }
+
+        std::vector<std::shared_ptr<Expression>> get_children() const {
+            return this->items;
+        }
     private:
+        static std::size_t get_size(CompilerContext &context, const std::shared_ptr<Expression> &expression) {
+            std::u32string name;
+
+            if (expression->get_rule_name(name)) {
+                const auto callee = context.symbols.find(name);
+
+                if (callee >= context.definitions.size()) {
+                    return 1;
+                }
+
+                auto &definition = context.definitions[callee];
+                const auto memoize = definition.options.memoize || context.settings.memoize;
+
+                if (!definition.item || definition.recursive || (definition.options.node && memoize)) {
+                    return 1;
+                }
+
+                if (!definition.size) {
+                    definition.size = get_size(context, definition.item);
+                }
+
+                return definition.size <= context.settings.inline_limit ? definition.size : 1;
+            }
+
+            std::size_t size = 1;
+
+            for (const auto &child: expression->get_children()) {
+                size += get_size(context, child);
+            }
+
+            return size;
+        }
+
+        static bool is_recursive(const CompilerContext &context, std::uint32_t rule) {
+            std::vector<bool> visited(context.definitions.size());
+            std::vector<std::shared_ptr<Expression>> pending = { context.definitions[rule].item };
+
+            while (!pending.empty()) {
+                const auto expression = pending.back();
+                pending.pop_back();
+
+                std::u32string name;
+
+                if (!expression->get_rule_name(name)) {
+                    const auto children = expression->get_children();
+                    pending.insert(pending.end(), children.begin(), children.end());
+                    continue;
+                }
+
+                const auto callee = context.symbols.find(name);
+
+                if (callee == rule) {
+                    return true;
+                }
+
+                if (callee < visited.size() && !visited[callee] && context.definitions[callee].item) {
+                    visited[callee] = true;
+                    pending.emplace_back(context.definitions[callee].item);
+                }
+            }
+
+            return false;
+        }
+
         const std::vector<std::shared_ptr<Expression>> items;
     };
 }
@@ -0,0 +1,13 @@
+#ifndef UFPEG_FIRST_HPP
+#define UFPEG_FIRST_HPP
+
+#include "characterset.hpp"
+
+namespace ufpeg {
+    struct First {
+        bool nullable;
+        CharacterRanges ranges;
+    };
+}
+
+#endif
@@ -5,7 +5,7 @@
 
 namespace ufpeg {
     struct Frame {
-        std::size_t success, failure;
+        std::size_t success, failure, pending;
     };
 }
 
@@ -0,0 +1,22 @@
+#ifndef UFPEG_GROWTH_POLICY_HPP
+#define UFPEG_GROWTH_POLICY_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+namespace ufpeg {
+    // How a BacktrackStack sizes its storage: it starts with room for
+    // `initial` entries and, once full, grows to capacity * factor +
+    // increment entries.
+    struct GrowthPolicy {
+        std::size_t initial = 256;
+        std::size_t factor = 2;
+        std::size_t increment = 0;
+
+        std::size_t get_capacity(std::size_t capacity) const {
+            return std::max(capacity * this->factor + this->increment, capacity + 1);
+        }
+    };
+}
+
+#endif
@@ -4,7 +4,7 @@
 #include <memory>
 
 #include "reference.hpp"
-#include "executorcontext.hpp"
+#include "program.hpp"
 
 #include <iostream>
 #include <iomanip>
@@ -24,13 +24,15 @@ namespace ufpeg {
 
         virtual ~Instruction() = default;
 
-        virtual void update(ExecutorContext &context) const = 0;
-
-        virtual void print() const = 0;
+        virtual Operation lower(Program &program) const = 0;
 
         const std::shared_ptr<Reference> &get_reference() const {
             return this->reference;
         }
+    protected:
+        static std::uint32_t get_operand(const std::shared_ptr<Reference> &reference) {
+            return static_cast<std::uint32_t>(reference->get_offset());
+        }
     private:
         const std::shared_ptr<Reference> reference;
     };
@@ -45,17 +47,13 @@ namespace ufpeg {
         ):
             Instruction(reference), target(target), success(success), failure(failure) {}
 
-        void update(ExecutorContext &context) const {
-            context.pointer = this->target->get_offset();
-
-            context.frames.push({
-                this->success->get_offset(),
-                this->failure->get_offset(),
-            });
-        }
-
-        void print() const {
-            std::cout << "INVOKE " << this->target->get_offset() << " " << this->success->get_offset() << " " << this->failure->get_offset() << std::endl;
+        Operation lower(Program &program) const {
+            return {
+                Opcode::INVOKE,
+                get_operand(this->success),
+                get_operand(this->failure),
+                get_operand(this->target),
+            };
         }
     private:
         const std::shared_ptr<Reference> target, success, failure;
@@ -63,27 +61,15 @@ namespace ufpeg {
 
     class RevokeSuccessInstruction: public Instruction {
     public:
-        void update(ExecutorContext &context) const {
-            context.pointer = context.frames.top().success;
-
-            context.frames.pop();
-        }
-
-        void print() const {
-            std::cout << "REVOKE_SUCCESS" << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::REVOKE_SUCCESS };
         }
     };
 
     class RevokeFailureInstruction: public Instruction {
     public:
-        void update(ExecutorContext &context) const {
-            context.pointer = context.frames.top().failure;
-
-            context.frames.pop();
-        }
-
-        void print() const {
-            std::cout << "REVOKE_FAILURE" << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::REVOKE_FAILURE };
         }
     };
 
@@ -95,14 +81,8 @@ namespace ufpeg {
         ):
             Instruction(reference), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            context.nodes.push({ {}, context.cursors.top() });
-
-            context.pointer = this->target->get_offset();
-        }
-
-        void print() const {
-            std::cout << "PREPARE " << this->target->get_offset() << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::PREPARE, get_operand(this->target) };
         }
     private:
         const std::shared_ptr<Reference> target;
@@ -111,28 +91,32 @@ namespace ufpeg {
     class ConsumeInstruction: public Instruction {
     public:
         ConsumeInstruction(
-            const std::u32string &name,
+            std::uint32_t rule,
             const std::shared_ptr<Reference> &target,
             const std::shared_ptr<Reference> &reference = {}
         ):
-            Instruction(reference), name(name), target(target) {}
+            Instruction(reference), rule(rule), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            auto child = std::move(context.nodes.top());
-            context.nodes.pop();
-            child.name = this->name;
-            child.stop = context.cursors.top();
-            auto &parent = context.nodes.top();
-            parent.children.emplace_back(child);
-
-            context.pointer = this->target->get_offset();
+        Operation lower(Program &program) const {
+            return { Opcode::CONSUME, get_operand(this->target), 0, this->rule };
         }
+    private:
+        const std::uint32_t rule;
+        const std::shared_ptr<Reference> target;
+    };
+
+    class SpliceInstruction: public Instruction {
+    public:
+        SpliceInstruction(
+            const std::shared_ptr<Reference> &target,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), target(target) {}
 
-        void print() const {
-            std::cout << "CONSUME \"" << u32tou8(this->name) << "\" " << this->target->get_offset() << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::SPLICE, get_operand(this->target) };
         }
     private:
-        const std::u32string name;
         const std::shared_ptr<Reference> target;
     };
 
@@ -144,14 +128,8 @@ namespace ufpeg {
         ):
             Instruction(reference), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            context.nodes.pop();
-
-            context.pointer = this->target->get_offset();
-        }
-
-        void print() const {
-            std::cout << "DISCARD " << this->target->get_offset() << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::DISCARD, get_operand(this->target) };
         }
     private:
         const std::shared_ptr<Reference> target;
@@ -165,15 +143,8 @@ namespace ufpeg {
         ):
             Instruction(reference), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            auto cursor = context.cursors.top();
-            context.cursors.push(cursor);
-
-            context.pointer = this->target->get_offset();
-        }
-
-        void print() const {
-            std::cout << "BEGIN " << this->target->get_offset() << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::BEGIN, get_operand(this->target) };
         }
     private:
         const std::shared_ptr<Reference> target;
@@ -187,16 +158,8 @@ namespace ufpeg {
         ):
             Instruction(reference), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            auto cursor = context.cursors.top();
-            context.cursors.pop();
-            context.cursors.top() = cursor;
-
-            context.pointer = this->target->get_offset();
-        }
-
-        void print() const {
-            std::cout << "COMMIT " << this->target->get_offset() << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::COMMIT, get_operand(this->target) };
         }
     private:
         const std::shared_ptr<Reference> target;
@@ -210,14 +173,8 @@ namespace ufpeg {
         ):
             Instruction(reference), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            context.cursors.pop();
-
-            context.pointer = this->target->get_offset();
-        }
-
-        void print() const {
-            std::cout << "ABORT " << this->target->get_offset() << std::endl;
+        Operation lower(Program &program) const {
+            return { Opcode::ABORT, get_operand(this->target) };
         }
     private:
         const std::shared_ptr<Reference> target;
@@ -233,24 +190,15 @@ namespace ufpeg {
         ):
             Instruction(reference), literal(literal), success(success), failure(failure) {}
 
-        void update(ExecutorContext &context) const {
-            auto &cursor = context.cursors.top();
-            const auto length = this->literal.length();
-
-            try {
-                if (!context.text.compare(cursor, length, this->literal)) {
-                    cursor += length;
-                    context.pointer = this->success->get_offset();
-                    return;
-                }
-            } catch (const std::out_of_range&) {
-            }
-
-            context.pointer = this->failure->get_offset();
-        }
+        Operation lower(Program &program) const {
+            program.literals.emplace_back(this->literal);
 
-        void print() const {
-            std::cout << "MATCH_LITERAL \"" << u32tou8(this->literal) << "\" " << this->success->get_offset() << " " << this->failure->get_offset() << std::endl;
+            return {
+                Opcode::MATCH_LITERAL,
+                get_operand(this->success),
+                get_operand(this->failure),
+                static_cast<std::uint32_t>(program.literals.size() - 1),
+            };
         }
     private:
         const std::u32string literal;
@@ -267,31 +215,119 @@ namespace ufpeg {
         ):
             Instruction(reference), min(min), max(max), success(success), failure(failure) {}
 
-        void update(ExecutorContext &context) const {
-            auto &cursor = context.cursors.top();
+        Operation lower(Program &program) const {
+            return {
+                Opcode::MATCH_RANGE,
+                get_operand(this->success),
+                get_operand(this->failure),
+                this->min,
+                this->max,
+            };
+        }
+    private:
+        const char32_t min, max;
+        const std::shared_ptr<Reference> success, failure;
+    };
 
-            try {
-                const auto code = context.text.at(cursor);
+    class MatchSetInstruction: public Instruction {
+    public:
+        MatchSetInstruction(
+            const CharacterRanges &ranges,
+            const std::shared_ptr<Reference> &success,
+            const std::shared_ptr<Reference> &failure,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), ranges(ranges), success(success), failure(failure) {}
 
-                if (this->min <= code && code <= this->max) {
-                    cursor++;
-                    context.pointer = this->success->get_offset();
-                    return;
-                }
-            } catch (const std::out_of_range&) {
-            }
+        Operation lower(Program &program) const {
+            program.sets.emplace_back(this->ranges);
 
-            context.pointer = this->failure->get_offset();
+            return {
+                Opcode::MATCH_SET,
+                get_operand(this->success),
+                get_operand(this->failure),
+                static_cast<std::uint32_t>(program.sets.size() - 1),
+            };
         }
+    private:
+        const CharacterRanges ranges;
+        const std::shared_ptr<Reference> success, failure;
+    };
 
-        void print() const {
-            std::cout << "MATCH_RANGE " << this->min << " " << this->max << " " << this->success->get_offset() << " " << this->failure->get_offset() << std::endl;
+    class MatchLiteralSetInstruction: public Instruction {
+    public:
+        MatchLiteralSetInstruction(
+            const std::vector<std::u32string> &literals,
+            const std::shared_ptr<Reference> &success,
+            const std::shared_ptr<Reference> &failure,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), literals(literals), success(success), failure(failure) {}
+
+        Operation lower(Program &program) const {
+            program.literal_sets.emplace_back(this->literals);
+
+            return {
+                Opcode::MATCH_LITERAL_SET,
+                get_operand(this->success),
+                get_operand(this->failure),
+                static_cast<std::uint32_t>(program.literal_sets.size() - 1),
+            };
         }
     private:
-        const char32_t min, max;
+        const std::vector<std::u32string> literals;
+        const std::shared_ptr<Reference> success, failure;
+    };
+
+    class TestSetInstruction: public Instruction {
+    public:
+        TestSetInstruction(
+            const CharacterRanges &ranges,
+            const std::shared_ptr<Reference> &success,
+            const std::shared_ptr<Reference> &failure,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), ranges(ranges), success(success), failure(failure) {}
+
+        Operation lower(Program &program) const {
+            program.sets.emplace_back(this->ranges);
+
+            return {
+                Opcode::TEST_SET,
+                get_operand(this->success),
+                get_operand(this->failure),
+                static_cast<std::uint32_t>(program.sets.size() - 1),
+            };
+        }
+    private:
+        const CharacterRanges ranges;
         const std::shared_ptr<Reference> success, failure;
     };
 
+    class SpanInstruction: public Instruction {
+    public:
+        SpanInstruction(
+            const CharacterRanges &ranges,
+            const std::shared_ptr<Reference> &target,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), ranges(ranges), target(target) {}
+
+        Operation lower(Program &program) const {
+            program.sets.emplace_back(this->ranges);
+
+            return {
+                Opcode::SPAN,
+                get_operand(this->target),
+                0,
+                static_cast<std::uint32_t>(program.sets.size() - 1),
+            };
+        }
+    private:
+        const CharacterRanges ranges;
+        const std::shared_ptr<Reference> target;
+    };
+
     class JumpInstruction: public Instruction {
     public:
         JumpInstruction(
@@ -300,42 +336,134 @@ namespace ufpeg {
         ):
             Instruction(reference), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            context.pointer = this->target->get_offset();
+        Operation lower(Program &program) const {
+            return { Opcode::JUMP, get_operand(this->target) };
         }
+    private:
+        const std::shared_ptr<Reference> target;
+    };
 
-        void print() const {
-            std::cout << "JUMP " << this->target->get_offset() << std::endl;
+    class CutInstruction: public Instruction {
+    public:
+        CutInstruction(
+            const std::shared_ptr<Reference> &target,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), target(target) {}
+
+        Operation lower(Program &program) const {
+            return { Opcode::CUT, get_operand(this->target) };
         }
     private:
         const std::shared_ptr<Reference> target;
     };
 
+    class SplitInstruction: public Instruction {
+    public:
+        SplitInstruction(
+            const std::shared_ptr<Reference> &target,
+            const std::shared_ptr<Reference> &item,
+            const std::shared_ptr<Reference> &resync,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), target(target), item(item), resync(resync) {}
+
+        Operation lower(Program &program) const {
+            return {
+                Opcode::SPLIT,
+                get_operand(this->target),
+                0,
+                get_operand(this->item),
+                get_operand(this->resync),
+            };
+        }
+    private:
+        const std::shared_ptr<Reference> target, item, resync;
+    };
+
     class ExpectInstruction: public Instruction {
     public:
         ExpectInstruction(
-            const std::u32string &name,
+            std::uint32_t rule,
             const std::shared_ptr<Reference> &target,
             const std::shared_ptr<Reference> &reference = {}
         ):
-            Instruction(reference), name(name), target(target) {}
+            Instruction(reference), rule(rule), target(target) {}
 
-        void update(ExecutorContext &context) const {
-            auto cursor = context.cursors.top();
-            if (cursor > context.offset) {
-                context.expectations.clear();
-                context.offset = cursor;
-            }
-            context.expectations.push_back(this->name);
+        Operation lower(Program &program) const {
+            return { Opcode::EXPECT, get_operand(this->target), 0, this->rule };
+        }
+    private:
+        const std::uint32_t rule;
+        const std::shared_ptr<Reference> target;
+    };
 
-            context.pointer = this->target->get_offset();
+    class RecallInstruction: public Instruction {
+    public:
+        RecallInstruction(
+            std::uint32_t rule,
+            const std::shared_ptr<Reference> &miss,
+            const std::shared_ptr<Reference> &success,
+            const std::shared_ptr<Reference> &failure,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), rule(rule), miss(miss), success(success), failure(failure) {}
+
+        Operation lower(Program &program) const {
+            return {
+                Opcode::RECALL,
+                get_operand(this->success),
+                get_operand(this->failure),
+                this->rule,
+                get_operand(this->miss),
+            };
         }
+    private:
+        const std::uint32_t rule;
+        const std::shared_ptr<Reference> miss, success, failure;
+    };
 
-        void print() const {
-            std::cout << "EXPECT \"" << u32tou8(this->name) << "\" " << this->target->get_offset() << std::endl;
+    class MemoizeSuccessInstruction: public Instruction {
+    public:
+        MemoizeSuccessInstruction(
+            std::uint32_t rule,
+            const std::shared_ptr<Reference> &target,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), rule(rule), target(target) {}
+
+        Operation lower(Program &program) const {
+            return {
+                Opcode::MEMOIZE_SUCCESS,
+                get_operand(this->target),
+                0,
+                this->rule,
+            };
+        }
+    private:
+        const std::uint32_t rule;
+        const std::shared_ptr<Reference> target;
+    };
+
+    class MemoizeFailureInstruction: public Instruction {
+    public:
+        MemoizeFailureInstruction(
+            std::uint32_t rule,
+            const std::shared_ptr<Reference> &target,
+            const std::shared_ptr<Reference> &reference = {}
+        ):
+            Instruction(reference), rule(rule), target(target) {}
+
+        Operation lower(Program &program) const {
+            return {
+                Opcode::MEMOIZE_FAILURE,
+                get_operand(this->target),
+                0,
+                this->rule,
+            };
         }
     private:
-        const std::u32string name;
+        const std::uint32_t rule;
         const std::shared_ptr<Reference> target;
     };
 }
@@ -0,0 +1,105 @@
+#ifndef UFPEG_LITERAL_SET_HPP
+#define UFPEG_LITERAL_SET_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "text.hpp"
+#include "trienode.hpp"
+
+namespace ufpeg {
+    const std::uint32_t NO_ALTERNATIVE = UINT32_MAX;
+
+    class LiteralSet {
+    public:
+        LiteralSet(const std::vector<std::u32string> &literals) {
+            std::vector<std::map<char32_t, std::uint32_t>> children(1);
+            std::vector<std::uint32_t> alternatives(1, NO_ALTERNATIVE);
+
+            for (std::uint32_t i = 0; i < literals.size(); i++) {
+                std::uint32_t node = 0;
+
+                for (auto code: literals[i]) {
+                    auto it = children[node].find(code);
+
+                    if (it == children[node].end()) {
+                        it = children[node].emplace(code, children.size()).first;
+                        children.emplace_back();
+                        alternatives.push_back(NO_ALTERNATIVE);
+                    }
+
+                    node = it->second;
+                }
+
+                alternatives[node] = std::min(alternatives[node], i);
+                this->length = std::max(this->length, literals[i].length());
+            }
+
+            for (std::size_t node = 0; node < children.size(); node++) {
+                const auto begin = this->edges.size();
+
+                this->edges.insert(this->edges.end(), children[node].begin(), children[node].end());
+                this->nodes.push_back({
+                    alternatives[node], alternatives[node], begin, this->edges.size(),
+                });
+            }
+
+            for (auto node = this->nodes.rbegin(); node != this->nodes.rend(); ++node) {
+                for (auto i = node->begin; i < node->end; i++) {
+                    node->best = std::min(node->best, this->nodes[this->edges[i].second].best);
+                }
+            }
+        }
+
+        template <typename Input>
+        bool match(const Input &text, std::size_t position, std::size_t &length) const {
+            auto best = NO_ALTERNATIVE;
+            std::size_t depth = 0;
+            auto node = &this->nodes.front();
+
+            while (true) {
+                if (node->alternative < best) {
+                    best = node->alternative;
+                    length = depth;
+                }
+
+                if (node->best >= best) {
+                    break;
+                }
+
+                const auto begin = this->edges.begin() + node->begin;
+                const auto end = this->edges.begin() + node->end;
+                const auto code = text.at(position + depth);
+                const auto it = std::lower_bound(
+                    begin, end, code,
+                    [](const std::pair<char32_t, std::uint32_t> &edge, char32_t code) {
+                        return edge.first < code;
+                    }
+                );
+
+                if (it == end || it->first != code) {
+                    break;
+                }
+
+                node = &this->nodes[it->second];
+                depth++;
+            }
+
+            return best != NO_ALTERNATIVE;
+        }
+
+        std::size_t get_length() const {
+            return this->length;
+        }
+    private:
+        std::size_t length = 0;
+        std::vector<TrieNode> nodes;
+        std::vector<std::pair<char32_t, std::uint32_t>> edges;
+    };
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef UFPEG_MARK_HPP
+#define UFPEG_MARK_HPP
+
+#include <cstddef>
+
+namespace ufpeg {
+    struct Mark {
+        std::size_t size, last, cursor;
+    };
+}
+
+#endif
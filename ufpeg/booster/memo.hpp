@@ -0,0 +1,17 @@
+#ifndef UFPEG_MEMO_HPP
+#define UFPEG_MEMO_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "node.hpp"
+
+namespace ufpeg {
+    struct Memo {
+        bool success;
+        std::size_t stop, reach;
+        std::vector<NodeRecord> records;
+    };
+}
+
+#endif
@@ -1,14 +1,119 @@
 #ifndef UFPEG_NODE_HPP
 #define UFPEG_NODE_HPP
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <vector>
 
+#include "symboltable.hpp"
+
 namespace ufpeg {
-    struct Node {
-        std::u32string name;
+    struct NodeRecord {
+        std::uint32_t rule;
         std::size_t start, stop;
-        std::vector<Node> children;
+        std::size_t child, sibling;
+    };
+
+    const std::size_t NO_NODE = SIZE_MAX;
+
+    class Node {
+    public:
+        class Iterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Node value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const Node *pointer;
+            typedef Node reference;
+
+            Iterator(const std::vector<NodeRecord> &records, std::size_t index):
+                records(&records), index(index) {}
+
+            Node operator*() const {
+                return { *this->records, this->index };
+            }
+
+            Iterator &operator++() {
+                this->index = (*this->records)[this->index].sibling;
+                return *this;
+            }
+
+            bool operator==(const Iterator &other) const {
+                return this->index == other.index;
+            }
+
+            bool operator!=(const Iterator &other) const {
+                return this->index != other.index;
+            }
+        private:
+            const std::vector<NodeRecord> *records;
+            std::size_t index;
+        };
+
+        Node(const std::vector<NodeRecord> &records, std::size_t index):
+            records(&records), index(index) {}
+
+        std::uint32_t get_rule() const {
+            return this->get_record().rule;
+        }
+
+        std::size_t get_start() const {
+            return this->get_record().start;
+        }
+
+        std::size_t get_stop() const {
+            return this->get_record().stop;
+        }
+
+        std::size_t get_index() const {
+            return this->index;
+        }
+
+        Iterator begin() const {
+            return { *this->records, this->get_record().child };
+        }
+
+        Iterator end() const {
+            return { *this->records, NO_NODE };
+        }
+
+        bool is_leaf() const {
+            return this->get_record().child == NO_NODE;
+        }
+    private:
+        const NodeRecord &get_record() const {
+            return (*this->records)[this->index];
+        }
+
+        const std::vector<NodeRecord> *records;
+        std::size_t index;
+    };
+
+    class Tree {
+    public:
+        Tree() = default;
+
+        Tree(std::vector<NodeRecord> &&records):
+            records(std::move(records)) {}
+
+        Node get_root() const {
+            return { this->records, 0 };
+        }
+
+        Node get_node(std::size_t index) const {
+            return { this->records, index };
+        }
+
+        std::size_t get_size() const {
+            return this->records.size();
+        }
+
+        std::vector<NodeRecord> release() {
+            return std::move(this->records);
+        }
+    private:
+        std::vector<NodeRecord> records;
     };
 }
 
@@ -2,26 +2,41 @@
 #define UFPEG_NODE_VISITOR_HPP
 
 #include <functional>
-#include <map>
+#include <stdexcept>
+#include <vector>
 
 #include "node.hpp"
+#include "symboltable.hpp"
 
 namespace ufpeg {
     template <typename T>
     class NodeVisitor {
         typedef std::function<T()> handler_type;
     public:
+        NodeVisitor(const SymbolTable &symbols):
+            symbols(symbols) {}
+
         void add_handler(const std::u32string &name, const handler_type &handler) {
-            this->handlers.emplace(name, handler);
+            const auto rule = this->symbols.find(name);
+            if (rule == NO_RULE) {
+                throw std::out_of_range("Rule is not defined");
+            }
+
+            if (rule >= this->handlers.size()) {
+                this->handlers.resize(rule + 1);
+            }
+
+            this->handlers[rule] = handler;
         }
 
         T visit(const Node &node) const {
-            auto &handler = this->handlers.at(node.name);
+            auto &handler = this->handlers.at(node.get_rule());
 
             return handler();
         }
     private:
-        std::map<std::u32string, handler_type> handlers;
+        const SymbolTable &symbols;
+        std::vector<handler_type> handlers;
     };
 }
 
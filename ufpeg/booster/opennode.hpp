@@ -0,0 +1,12 @@
+#ifndef UFPEG_OPEN_NODE_HPP
+#define UFPEG_OPEN_NODE_HPP
+
+#include <cstddef>
+
+namespace ufpeg {
+    struct OpenNode {
+        std::size_t index, last;
+    };
+}
+
+#endif
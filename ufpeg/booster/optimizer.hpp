@@ -0,0 +1,241 @@
+#ifndef UFPEG_OPTIMIZER_HPP
+#define UFPEG_OPTIMIZER_HPP
+
+#include <vector>
+
+#include "program.hpp"
+#include "optimizerreport.hpp"
+
+namespace ufpeg {
+    class Optimizer {
+    public:
+        Program optimize(Program program) {
+            this->report.before = program.operations.size();
+
+            thread(program);
+            fuse(program);
+            tail(program);
+            eliminate(program);
+
+            this->report.after = program.operations.size();
+
+            return program;
+        }
+
+        const OptimizerReport &get_report() const {
+            return this->report;
+        }
+    private:
+        static std::vector<std::uint32_t*> get_pointers(Operation &operation) {
+            switch (operation.opcode) {
+            case Opcode::INVOKE:
+                return { &operation.first, &operation.target, &operation.failure };
+            case Opcode::TAIL_INVOKE:
+                return { &operation.first };
+            case Opcode::RECALL:
+                return { &operation.second, &operation.target, &operation.failure };
+            case Opcode::SPLIT:
+                return { &operation.target, &operation.first, &operation.second };
+            case Opcode::MATCH_LITERAL:
+            case Opcode::MATCH_RANGE:
+            case Opcode::MATCH_SET:
+            case Opcode::MATCH_LITERAL_SET:
+            case Opcode::MATCH_LITERAL_NODE:
+            case Opcode::MATCH_SET_NODE:
+            case Opcode::TEST_SET:
+                return { &operation.target, &operation.failure };
+            case Opcode::REVOKE_SUCCESS:
+            case Opcode::REVOKE_FAILURE:
+            case Opcode::CONSUME_REVOKE:
+            case Opcode::DISCARD_REVOKE:
+                return {};
+            default:
+                return { &operation.target };
+            }
+        }
+
+        static std::uint32_t follow(const Program &program, std::uint32_t pointer) {
+            const auto &operations = program.operations;
+
+            for (std::size_t i = 0; i < operations.size() && operations[pointer].opcode == Opcode::JUMP; i++) {
+                pointer = operations[pointer].target;
+            }
+
+            return pointer;
+        }
+
+        static void thread(Program &program) {
+            for (auto &operation: program.operations) {
+                for (auto pointer: get_pointers(operation)) {
+                    *pointer = follow(program, *pointer);
+                }
+            }
+
+            for (auto &operation: program.operations) {
+                if (operation.opcode != Opcode::JUMP) {
+                    continue;
+                }
+
+                const auto &target = program.operations[operation.target];
+
+                if (target.opcode == Opcode::REVOKE_SUCCESS || target.opcode == Opcode::REVOKE_FAILURE) {
+                    operation = target;
+                }
+            }
+        }
+
+        static void fuse(Program &program) {
+            auto &operations = program.operations;
+
+            for (auto &operation: operations) {
+                if (operation.opcode == Opcode::PREPARE) {
+                    fuse_node(program, operation);
+                }
+            }
+
+            for (auto &operation: operations) {
+                const auto opcode = operations[operation.target].opcode;
+
+                if (operation.opcode == Opcode::CONSUME && opcode == Opcode::REVOKE_SUCCESS) {
+                    operation = { Opcode::CONSUME_REVOKE, 0, 0, operation.first };
+                } else if (operation.opcode == Opcode::DISCARD && opcode == Opcode::REVOKE_FAILURE) {
+                    operation = { Opcode::DISCARD_REVOKE };
+                }
+            }
+        }
+
+        static void fuse_node(Program &program, Operation &prepare) {
+            const auto match = program.operations[prepare.target];
+            const auto consume = program.operations[match.target];
+            const auto discard = program.operations[match.failure];
+
+            if (consume.opcode != Opcode::CONSUME || discard.opcode != Opcode::DISCARD) {
+                return;
+            }
+
+            switch (match.opcode) {
+            case Opcode::MATCH_LITERAL:
+                prepare = {
+                    Opcode::MATCH_LITERAL_NODE, consume.target, discard.target, match.first, consume.first,
+                };
+                break;
+            case Opcode::MATCH_SET:
+                prepare = {
+                    Opcode::MATCH_SET_NODE, consume.target, discard.target, match.first, consume.first,
+                };
+                break;
+            case Opcode::MATCH_RANGE:
+                program.sets.emplace_back(CharacterRanges({ { match.first, match.second } }));
+                prepare = {
+                    Opcode::MATCH_SET_NODE, consume.target, discard.target,
+                    static_cast<std::uint32_t>(program.sets.size() - 1), consume.first,
+                };
+                break;
+            default:
+                break;
+            }
+        }
+
+        static void tail(Program &program) {
+            auto &operations = program.operations;
+            const auto size = operations.size();
+
+            for (std::size_t i = 0; i < size; i++) {
+                const auto operation = operations[i];
+
+                if (operation.opcode != Opcode::INVOKE) {
+                    continue;
+                }
+
+                std::size_t commits = 0;
+                std::size_t aborts = 0;
+
+                const auto success = operations[skip(program, operation.target, Opcode::COMMIT, commits)];
+                const auto failure = operations[skip(program, operation.failure, Opcode::ABORT, aborts)];
+
+                if (commits != aborts) {
+                    continue;
+                }
+
+                if (
+                    commits == 0 &&
+                    success.opcode == Opcode::REVOKE_SUCCESS && failure.opcode == Opcode::REVOKE_FAILURE
+                ) {
+                    operations[i] = { Opcode::JUMP, follow(program, operation.first) };
+                } else if (success.opcode == Opcode::CONSUME_REVOKE && failure.opcode == Opcode::DISCARD_REVOKE) {
+                    // The marks left open by enclosing sequences are only
+                    // needed to rewind a failure, and DISCARD_REVOKE drops
+                    // everything they guard, so they are committed before
+                    // the call instead of after it.
+                    Operation call = { Opcode::TAIL_INVOKE, 0, 0, operation.first, success.first };
+
+                    for (std::size_t j = 0; j < commits; j++) {
+                        operations.push_back(call);
+                        call = { Opcode::COMMIT, static_cast<std::uint32_t>(operations.size() - 1) };
+                    }
+
+                    operations[i] = call;
+                }
+            }
+        }
+
+        static std::uint32_t skip(
+            const Program &program,
+            std::uint32_t pointer,
+            Opcode opcode,
+            std::size_t &count
+        ) {
+            const auto &operations = program.operations;
+
+            for (pointer = follow(program, pointer); operations[pointer].opcode == opcode; count++) {
+                pointer = follow(program, operations[pointer].target);
+            }
+
+            return pointer;
+        }
+
+        static void eliminate(Program &program) {
+            auto &operations = program.operations;
+
+            std::vector<bool> reachable(operations.size());
+            std::vector<std::uint32_t> pending = { 0 };
+
+            reachable[0] = true;
+
+            while (!pending.empty()) {
+                auto operation = operations[pending.back()];
+                pending.pop_back();
+
+                for (auto pointer: get_pointers(operation)) {
+                    if (!reachable[*pointer]) {
+                        reachable[*pointer] = true;
+                        pending.push_back(*pointer);
+                    }
+                }
+            }
+
+            std::vector<std::uint32_t> offsets(operations.size());
+            std::uint32_t size = 0;
+
+            for (std::size_t i = 0; i < operations.size(); i++) {
+                offsets[i] = size;
+
+                if (reachable[i]) {
+                    operations[size++] = operations[i];
+                }
+            }
+
+            operations.resize(size);
+
+            for (auto &operation: operations) {
+                for (auto pointer: get_pointers(operation)) {
+                    *pointer = offsets[*pointer];
+                }
+            }
+        }
+
+        OptimizerReport report = { 0, 0 };
+    };
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef UFPEG_OPTIMIZER_REPORT_HPP
+#define UFPEG_OPTIMIZER_REPORT_HPP
+
+#include <cstddef>
+
+namespace ufpeg {
+    struct OptimizerReport {
+        std::size_t before, after;
+    };
+}
+
+#endif
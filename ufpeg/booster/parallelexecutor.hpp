@@ -0,0 +1,259 @@
+#ifndef UFPEG_PARALLEL_EXECUTOR_HPP
+#define UFPEG_PARALLEL_EXECUTOR_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "executor.hpp"
+#include "scheduler.hpp"
+
+namespace ufpeg {
+    const std::size_t NO_POSITION = SIZE_MAX;
+
+    // Parses the repetitions marked with SplitExpression speculatively: the
+    // rest of the input is cut at positions where the resync expression
+    // matches, every piece is parsed as a run of items on its own thread,
+    // and the runs are stitched together as long as each one starts where
+    // the previous one stopped. Whatever cannot be stitched is parsed
+    // sequentially, so the tree is always the one Executor would build.
+    class ParallelExecutor {
+    public:
+        ParallelExecutor(const Executor &executor, const Scheduler &scheduler, std::size_t grain = 65536):
+            executor(executor), scheduler(scheduler), grain(std::max<std::size_t>(1, grain)) {}
+
+        Tree execute(const std::u32string &text) const {
+            return this->execute(text.data(), text.length());
+        }
+
+        Tree execute(const std::string &text) const {
+            return this->execute(
+                reinterpret_cast<const unsigned char*>(text.data()), text.length()
+            );
+        }
+
+        template <typename T>
+        Tree execute(const T *data, std::size_t length) const {
+            const Text<T> text(data, length);
+            ExecutorContext context;
+
+            this->executor.start(context);
+            context.splitting = true;
+
+            while (!this->executor.run(context, text)) {
+                this->split(context, text);
+            }
+
+            return { std::move(context.records) };
+        }
+    private:
+        struct Item {
+            std::size_t start, index;
+        };
+
+        struct Chunk {
+            ExecutorContext context;
+            std::vector<Item> items;
+            std::size_t stop;
+            bool complete;
+        };
+
+        template <typename Input>
+        void split(ExecutorContext &context, const Input &text) const {
+            const auto &operation = this->executor.get_program().operations[context.pointer];
+            const auto start = context.cursor;
+            const auto length = text.get_length();
+
+            context.pointer = operation.target;
+
+            if (start >= length || length - start < 2 * this->grain) {
+                return;
+            }
+
+            const auto count = std::min(
+                this->scheduler.get_threads() * 4, (length - start) / this->grain
+            );
+
+            std::vector<std::size_t> boundaries(count + 1, NO_POSITION);
+            std::vector<ExecutorContext> contexts(this->scheduler.get_threads());
+
+            boundaries.front() = start;
+            boundaries.back() = length + 1;
+
+            this->scheduler.run(count - 1, [&](std::size_t worker, std::size_t index) {
+                boundaries[index + 1] = this->synchronize(
+                    contexts[worker], text, operation.second,
+                    start + (length - start) * (index + 1) / count,
+                    start + (length - start) * (index + 2) / count
+                );
+            });
+
+            auto last = boundaries.begin();
+
+            for (auto it = boundaries.begin() + 1; it != boundaries.end(); ++it) {
+                if (*it != NO_POSITION && *it > *last) {
+                    *++last = *it;
+                }
+            }
+
+            boundaries.erase(last + 1, boundaries.end());
+
+            std::vector<Chunk> chunks(boundaries.size() - 1);
+
+            this->scheduler.run(chunks.size(), [&](std::size_t worker, std::size_t index) {
+                this->parse(chunks[index], text, operation.first, boundaries[index], boundaries[index + 1]);
+            });
+
+            auto position = start;
+
+            for (std::size_t index = 0; index < chunks.size(); index++) {
+                const auto &chunk = chunks[index];
+
+                if (position >= boundaries[index + 1]) {
+                    continue;
+                }
+
+                const auto item = std::lower_bound(
+                    chunk.items.begin(), chunk.items.end(), position,
+                    [](const Item &item, std::size_t position) {
+                        return item.start < position;
+                    }
+                );
+
+                if (item != chunk.items.end() && item->start == position) {
+                    splice(context, chunk, item->index);
+                    position = chunk.stop;
+
+                    if (!chunk.complete) {
+                        break;
+                    }
+
+                    continue;
+                }
+
+                Chunk repair;
+
+                this->parse(repair, text, operation.first, position, boundaries[index + 1]);
+                splice(
+                    context, repair,
+                    repair.items.empty() ? repair.context.records.size() : repair.items.front().index
+                );
+                position = repair.stop;
+
+                if (!repair.complete) {
+                    break;
+                }
+            }
+
+            context.cursor = position;
+        }
+
+        template <typename Input>
+        std::size_t synchronize(
+            ExecutorContext &context,
+            const Input &text,
+            std::uint32_t entry,
+            std::size_t from,
+            std::size_t to
+        ) const {
+            for (auto position = from; position < to; position++) {
+                this->executor.start(context, entry, position);
+                this->executor.run(context, text);
+
+                if (Executor::is_matched(context)) {
+                    return context.cursor;
+                }
+            }
+
+            return NO_POSITION;
+        }
+
+        template <typename Input>
+        void parse(
+            Chunk &chunk,
+            const Input &text,
+            std::uint32_t entry,
+            std::size_t start,
+            std::size_t limit
+        ) const {
+            auto &context = chunk.context;
+
+            chunk.stop = start;
+            chunk.complete = false;
+
+            this->executor.start(context, entry, start);
+
+            while (true) {
+                chunk.items.push_back({ chunk.stop, context.records.size() });
+
+                this->executor.run(context, text);
+
+                if (!Executor::is_matched(context) || context.cursor == chunk.stop) {
+                    context.records.resize(chunk.items.back().index);
+                    chunk.items.pop_back();
+                    return;
+                }
+
+                chunk.stop = context.cursor;
+
+                if (chunk.stop >= limit) {
+                    chunk.complete = true;
+                    return;
+                }
+
+                Executor::invoke(context, entry);
+            }
+        }
+
+        static void splice(ExecutorContext &context, const Chunk &chunk, std::size_t first) {
+            const auto &records = chunk.context.records;
+
+            if (chunk.context.offset > context.offset) {
+                context.offset = chunk.context.offset;
+                context.expectations = chunk.context.expectations;
+            } else if (chunk.context.offset == context.offset) {
+                for (auto rule: chunk.context.expectations) {
+                    context.expectations.insert(rule);
+                }
+            }
+
+            if (first == records.size()) {
+                return;
+            }
+
+            const auto base = context.records.size();
+
+            for (auto it = records.begin() + first; it != records.end(); ++it) {
+                auto record = *it;
+                if (record.child != NO_NODE) {
+                    record.child = record.child - first + base;
+                }
+                if (record.sibling != NO_NODE) {
+                    record.sibling = record.sibling - first + base;
+                }
+                context.records.push_back(record);
+            }
+
+            auto last = base;
+
+            while (context.records[last].sibling != NO_NODE) {
+                last = context.records[last].sibling;
+            }
+
+            auto &parent = context.node;
+
+            if (parent.last == NO_NODE) {
+                context.records[parent.index].child = base;
+            } else {
+                context.records[parent.last].sibling = base;
+            }
+
+            parent.last = last;
+        }
+
+        const Executor &executor;
+        const Scheduler &scheduler;
+        const std::size_t grain;
+    };
+}
+
+#endif
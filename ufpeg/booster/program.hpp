@@ -0,0 +1,60 @@
+#ifndef UFPEG_PROGRAM_HPP
+#define UFPEG_PROGRAM_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "symboltable.hpp"
+#include "characterset.hpp"
+#include "literalset.hpp"
+
+namespace ufpeg {
+    enum class Opcode: std::uint8_t {
+        INVOKE,
+        REVOKE_SUCCESS,
+        REVOKE_FAILURE,
+        PREPARE,
+        CONSUME,
+        DISCARD,
+        BEGIN,
+        COMMIT,
+        ABORT,
+        MATCH_LITERAL,
+        MATCH_RANGE,
+        JUMP,
+        EXPECT,
+        RECALL,
+        MEMOIZE_SUCCESS,
+        MEMOIZE_FAILURE,
+        MATCH_SET,
+        SPAN,
+        MATCH_LITERAL_SET,
+        TEST_SET,
+        SPLICE,
+        MATCH_LITERAL_NODE,
+        MATCH_SET_NODE,
+        CONSUME_REVOKE,
+        DISCARD_REVOKE,
+        TAIL_INVOKE,
+        CUT,
+        SPLIT,
+    };
+
+    struct Operation {
+        Opcode opcode;
+        std::uint32_t target, failure;
+        std::uint32_t first, second;
+    };
+
+    struct Program {
+        std::vector<Operation> operations;
+        std::vector<std::u32string> literals;
+        std::vector<CharacterSet> sets;
+        std::vector<LiteralSet> literal_sets;
+        SymbolTable symbols;
+        std::uint32_t start = NO_RULE;
+    };
+}
+
+#endif
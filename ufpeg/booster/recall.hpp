@@ -0,0 +1,12 @@
+#ifndef UFPEG_RECALL_HPP
+#define UFPEG_RECALL_HPP
+
+#include <cstddef>
+
+namespace ufpeg {
+    struct Recall {
+        std::size_t reach, start, size;
+    };
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef UFPEG_RECOGNITION_HPP
+#define UFPEG_RECOGNITION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "symboltable.hpp"
+
+namespace ufpeg {
+    // The verdict of Executor::recognize(). The length is that of the match
+    // and zero on failure; offset and expectations describe the furthest
+    // failure and are only filled in when the program tracks failures.
+    struct Recognition {
+        bool matched;
+        std::size_t length;
+        std::size_t offset;
+        std::vector<std::uint32_t> expectations;
+
+        // Expectations are kept as rule ids while parsing; their names are
+        // only looked up once somebody asks for them.
+        std::vector<std::u32string> get_expected(const SymbolTable &symbols) const {
+            std::vector<std::u32string> names;
+
+            for (auto rule: this->expectations) {
+                names.push_back(symbols.get_name(rule));
+            }
+
+            return names;
+        }
+    };
+}
+
+#endif
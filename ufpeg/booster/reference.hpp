@@ -1,7 +1,7 @@
 #ifndef UFPEG_REFERENCE_HPP
 #define UFPEG_REFERENCE_HPP
 
-#include <exception>
+#include <stdexcept>
 
 namespace ufpeg {
     class Reference {
@@ -0,0 +1,11 @@
+#ifndef UFPEG_RULE_OPTIONS_HPP
+#define UFPEG_RULE_OPTIONS_HPP
+
+namespace ufpeg {
+    struct RuleOptions {
+        bool memoize = false;
+        bool node = true;
+    };
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef UFPEG_SCHEDULER_HPP
+#define UFPEG_SCHEDULER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ufpeg {
+    class Scheduler {
+    public:
+        Scheduler(std::size_t threads = 0):
+            threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+        std::size_t get_threads() const {
+            return this->threads;
+        }
+
+        // Calls task(worker, index) once for every index below count. Each
+        // worker starts with an even share of the indices and steals half of
+        // the remaining share of another worker when it runs out.
+        template <typename Task>
+        void run(std::size_t count, const Task &task) const {
+            const auto threads = std::max<std::size_t>(1, std::min(this->threads, count));
+            std::unique_ptr<Queue[]> queues(new Queue[threads]);
+
+            for (std::size_t i = 0; i < threads; i++) {
+                queues[i].begin = count * i / threads;
+                queues[i].end = count * (i + 1) / threads;
+            }
+
+            std::mutex mutex;
+            std::exception_ptr error;
+
+            auto work = [&](std::size_t worker) {
+                try {
+                    std::size_t index;
+
+                    while (pop(queues[worker], index) || steal(queues.get(), threads, worker, index)) {
+                        task(worker, index);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            };
+
+            std::vector<std::thread> workers;
+
+            try {
+                for (std::size_t i = 1; i < threads; i++) {
+                    workers.emplace_back(work, i);
+                }
+            } catch (...) {
+                for (auto &worker: workers) {
+                    worker.join();
+                }
+
+                throw;
+            }
+
+            work(0);
+
+            for (auto &worker: workers) {
+                worker.join();
+            }
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::size_t begin, end;
+        };
+
+        static bool pop(Queue &queue, std::size_t &index) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (queue.begin == queue.end) {
+                return false;
+            }
+
+            index = queue.begin++;
+
+            return true;
+        }
+
+        static bool steal(Queue *queues, std::size_t threads, std::size_t worker, std::size_t &index) {
+            for (std::size_t i = 1; i < threads; i++) {
+                auto &victim = queues[(worker + i) % threads];
+                std::size_t begin, end;
+
+                {
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+
+                    if (victim.begin == victim.end) {
+                        continue;
+                    }
+
+                    end = victim.end;
+                    begin = victim.end = victim.end - (victim.end - victim.begin + 1) / 2;
+                }
+
+                auto &queue = queues[worker];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+
+                queue.begin = begin + 1;
+                queue.end = end;
+                index = begin;
+
+                return true;
+            }
+
+            return false;
+        }
+
+        const std::size_t threads;
+    };
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef UFPEG_SESSION_HPP
+#define UFPEG_SESSION_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "executor.hpp"
+#include "streamtext.hpp"
+
+namespace ufpeg {
+    template <typename T>
+    class Session {
+    public:
+        Session(const Executor &executor):
+            executor(executor) {
+            executor.start(this->context);
+        }
+
+        std::vector<Tree> feed(const T *data, std::size_t length) {
+            this->discard();
+
+            if (!this->finished) {
+                this->buffer.insert(this->buffer.end(), data, data + length);
+                this->finished = this->executor.run(
+                    this->context, StreamText<T>(this->buffer, this->offset, false)
+                );
+            }
+
+            return this->release(this->finished ? this->context.records.size() : this->context.committed);
+        }
+
+        std::vector<Tree> close() {
+            this->discard();
+
+            if (!this->finished) {
+                this->finished = this->executor.run(
+                    this->context, StreamText<T>(this->buffer, this->offset, true)
+                );
+            }
+
+            if (!this->is_matched()) {
+                return {};
+            }
+
+            return this->release(this->context.records.size());
+        }
+
+        bool is_finished() const {
+            return this->finished;
+        }
+
+        bool is_matched() const {
+            return Executor::is_matched(this->context);
+        }
+
+        const T *get_data(std::size_t position) const {
+            return this->buffer.data() + (position - this->offset);
+        }
+    private:
+        std::size_t get_parent() const {
+            return this->executor.get_program().start == NO_RULE ? 0 : 1;
+        }
+
+        void discard() {
+            auto position = this->context.floor;
+            const auto parent = this->get_parent();
+
+            if (parent + 1 < this->context.records.size()) {
+                position = std::min(position, this->context.records[parent + 1].start);
+            }
+
+            const auto count = position - this->offset;
+
+            if (count > 0 && count >= this->buffer.size() / 2) {
+                this->buffer.erase(this->buffer.begin(), this->buffer.begin() + count);
+                this->offset = position;
+            }
+        }
+
+        std::vector<Tree> release(std::size_t limit) {
+            auto &records = this->context.records;
+            const auto parent = this->get_parent();
+
+            if (parent >= records.size()) {
+                return {};
+            }
+
+            std::vector<std::size_t> children;
+
+            for (auto child = records[parent].child; child != NO_NODE && child < limit; child = records[child].sibling) {
+                children.push_back(child);
+            }
+
+            if (children.empty()) {
+                return {};
+            }
+
+            auto &stack = this->context.stack;
+
+            const auto first = children.front();
+            const auto next = records[children.back()].sibling;
+            auto end = next;
+
+            if (end == NO_NODE) {
+                end = records.size();
+
+                if (this->context.node.index > parent) {
+                    end = std::min(end, this->context.node.index);
+                }
+
+                for (const auto &entry: stack) {
+                    if (entry.tag == StackTag::NODE && entry.node.index > parent) {
+                        end = std::min(end, entry.node.index);
+                    }
+                }
+            }
+
+            std::vector<Tree> trees;
+
+            for (std::size_t i = 0; i < children.size(); i++) {
+                const auto start = children[i];
+                const auto stop = i + 1 < children.size() ? children[i + 1] : end;
+
+                std::vector<NodeRecord> subtree(records.begin() + start, records.begin() + stop);
+
+                for (auto &record: subtree) {
+                    if (record.child != NO_NODE) {
+                        record.child -= start;
+                    }
+                    if (record.sibling != NO_NODE) {
+                        record.sibling -= start;
+                    }
+                }
+
+                subtree.front().sibling = NO_NODE;
+                trees.emplace_back(std::move(subtree));
+            }
+
+            const auto count = end - first;
+
+            records.erase(records.begin() + first, records.begin() + end);
+
+            for (auto it = records.begin() + first; it != records.end(); ++it) {
+                if (it->child != NO_NODE) {
+                    it->child -= count;
+                }
+                if (it->sibling != NO_NODE) {
+                    it->sibling -= count;
+                }
+            }
+
+            records[parent].child = next == NO_NODE ? NO_NODE : first;
+
+            shift(this->context.node, first, end);
+
+            for (auto &entry: stack) {
+                if (entry.tag == StackTag::NODE) {
+                    shift(entry.node, first, end);
+                } else if (entry.tag == StackTag::MARK) {
+                    entry.mark.size = shift(entry.mark.size, first, end, first);
+                    entry.mark.last = shift(entry.mark.last, first, end, NO_NODE);
+                } else if (entry.tag == StackTag::RECALL) {
+                    entry.recall.size = shift(entry.recall.size, first, end, first);
+                }
+            }
+
+            this->context.committed = shift(this->context.committed, first, end, first);
+
+            return trees;
+        }
+
+        static std::size_t shift(std::size_t index, std::size_t first, std::size_t end, std::size_t fallback) {
+            if (index == NO_NODE || index < first) {
+                return index;
+            }
+
+            return index < end ? fallback : index - (end - first);
+        }
+
+        static void shift(OpenNode &node, std::size_t first, std::size_t end) {
+            node.index = shift(node.index, first, end, first);
+            node.last = shift(node.last, first, end, NO_NODE);
+        }
+
+        const Executor &executor;
+        ExecutorContext context;
+        std::vector<T> buffer;
+        std::size_t offset = 0;
+        bool finished = false;
+    };
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef UFPEG_SPAN_HPP
+#define UFPEG_SPAN_HPP
+
+#include <cstddef>
+
+#include "characterset.hpp"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define UFPEG_SPAN_SIMD
+#include <immintrin.h>
+#endif
+
+namespace ufpeg {
+    const std::size_t SPAN_SIMD_RANGES = 8;
+
+    template <typename T>
+    std::size_t span_scalar(const CharacterSet &set, const T *data, std::size_t length) {
+        std::size_t count = 0;
+
+        while (count < length && set.contains(data[count])) {
+            count++;
+        }
+
+        return count;
+    }
+
+    template <typename T>
+    std::size_t span(const CharacterSet &set, const T *data, std::size_t length) {
+        return span_scalar(set, data, length);
+    }
+
+#ifdef UFPEG_SPAN_SIMD
+    inline std::size_t span_sse2(const CharacterSet &set, const unsigned char *data, std::size_t length) {
+        const auto &ranges = set.get_byte_ranges();
+        const auto zero = _mm_setzero_si128();
+
+        __m128i mins[SPAN_SIMD_RANGES], extents[SPAN_SIMD_RANGES];
+
+        for (std::size_t i = 0; i < ranges.size(); i++) {
+            mins[i] = _mm_set1_epi8(static_cast<char>(ranges[i].first));
+            extents[i] = _mm_set1_epi8(static_cast<char>(ranges[i].second - ranges[i].first));
+        }
+
+        std::size_t count = 0;
+
+        for (; count + 16 <= length; count += 16) {
+            const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + count));
+            auto hits = zero;
+
+            for (std::size_t i = 0; i < ranges.size(); i++) {
+                const auto offsets = _mm_sub_epi8(chunk, mins[i]);
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_subs_epu8(offsets, extents[i]), zero));
+            }
+
+            const unsigned misses = ~_mm_movemask_epi8(hits) & 0xFFFF;
+
+            if (misses) {
+                return count + __builtin_ctz(misses);
+            }
+        }
+
+        return count + span_scalar(set, data + count, length - count);
+    }
+
+    __attribute__((target("avx2")))
+    inline std::size_t span_avx2(const CharacterSet &set, const unsigned char *data, std::size_t length) {
+        const auto &ranges = set.get_byte_ranges();
+        const auto zero = _mm256_setzero_si256();
+
+        __m256i mins[SPAN_SIMD_RANGES], extents[SPAN_SIMD_RANGES];
+
+        for (std::size_t i = 0; i < ranges.size(); i++) {
+            mins[i] = _mm256_set1_epi8(static_cast<char>(ranges[i].first));
+            extents[i] = _mm256_set1_epi8(static_cast<char>(ranges[i].second - ranges[i].first));
+        }
+
+        std::size_t count = 0;
+
+        for (; count + 32 <= length; count += 32) {
+            const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + count));
+            auto hits = zero;
+
+            for (std::size_t i = 0; i < ranges.size(); i++) {
+                const auto offsets = _mm256_sub_epi8(chunk, mins[i]);
+                hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(_mm256_subs_epu8(offsets, extents[i]), zero));
+            }
+
+            const unsigned misses = ~static_cast<unsigned>(_mm256_movemask_epi8(hits));
+
+            if (misses) {
+                return count + __builtin_ctz(misses);
+            }
+        }
+
+        return count + span_sse2(set, data + count, length - count);
+    }
+
+    template <>
+    inline std::size_t span(const CharacterSet &set, const unsigned char *data, std::size_t length) {
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+
+        if (set.get_byte_ranges().size() > SPAN_SIMD_RANGES) {
+            return span_scalar(set, data, length);
+        }
+
+        return avx2 ? span_avx2(set, data, length) : span_sse2(set, data, length);
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef UFPEG_STACK_ENTRY_HPP
+#define UFPEG_STACK_ENTRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "frame.hpp"
+#include "opennode.hpp"
+#include "mark.hpp"
+#include "recall.hpp"
+
+namespace ufpeg {
+    enum class StackTag: std::uint8_t {
+        FRAME,
+        NODE,
+        MARK,
+        RECALL,
+        CLOSED,
+    };
+
+    struct StackEntry {
+        StackTag tag;
+        union {
+            Frame frame;
+            OpenNode node;
+            Mark mark;
+            Recall recall;
+        };
+    };
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef UFPEG_STREAM_TEXT_HPP
+#define UFPEG_STREAM_TEXT_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "text.hpp"
+
+namespace ufpeg {
+    template <typename T>
+    class StreamText {
+    public:
+        StreamText(const std::vector<T> &buffer, std::size_t offset, bool closed):
+            text(buffer.data(), buffer.size()), offset(offset), closed(closed) {}
+
+        bool is_available(std::size_t position, std::size_t length) const {
+            return this->closed || position + length <= this->get_length();
+        }
+
+        bool matches(std::size_t position, const std::u32string &literal) const {
+            return this->text.matches(position - this->offset, literal);
+        }
+
+        char32_t at(std::size_t position) const {
+            return this->text.at(position - this->offset);
+        }
+
+        std::size_t span(std::size_t position, const CharacterSet &set) const {
+            return this->offset + this->text.span(position - this->offset, set);
+        }
+
+        std::size_t get_length() const {
+            return this->offset + this->text.get_length();
+        }
+    private:
+        const Text<T> text;
+        const std::size_t offset;
+        const bool closed;
+    };
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef UFPEG_SYMBOL_TABLE_HPP
+#define UFPEG_SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ufpeg {
+    const std::uint32_t NO_RULE = UINT32_MAX;
+
+    class SymbolTable {
+    public:
+        std::uint32_t intern(const std::u32string &name) {
+            auto it = this->ids.find(name);
+            if (it != this->ids.end()) {
+                return it->second;
+            }
+
+            const auto id = static_cast<std::uint32_t>(this->names.size());
+
+            this->names.emplace_back(name);
+            this->ids.emplace(name, id);
+
+            return id;
+        }
+
+        std::uint32_t find(const std::u32string &name) const {
+            auto it = this->ids.find(name);
+
+            return it == this->ids.end() ? NO_RULE : it->second;
+        }
+
+        const std::u32string &get_name(std::uint32_t id) const {
+            return this->names.at(id);
+        }
+
+        std::size_t get_size() const {
+            return this->names.size();
+        }
+    private:
+        std::vector<std::u32string> names;
+        std::unordered_map<std::u32string, std::uint32_t> ids;
+    };
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef UFPEG_TEXT_HPP
+#define UFPEG_TEXT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "span.hpp"
+
+namespace ufpeg {
+    const char32_t END_OF_TEXT = UINT32_MAX;
+
+    template <typename T>
+    class Text {
+    public:
+        Text(const T *data, std::size_t length):
+            data(data), length(length) {}
+
+        bool matches(std::size_t position, const std::u32string &literal) const {
+            if (literal.length() > this->length - position) {
+                return false;
+            }
+
+            const auto data = this->data + position;
+
+            for (std::size_t i = 0; i < literal.length(); i++) {
+                if (static_cast<char32_t>(data[i]) != literal[i]) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool is_available(std::size_t position, std::size_t length) const {
+            return true;
+        }
+
+        char32_t at(std::size_t position) const {
+            return position < this->length ? this->data[position] : END_OF_TEXT;
+        }
+
+        std::size_t span(std::size_t position, const CharacterSet &set) const {
+            if (position >= this->length) {
+                return position;
+            }
+
+            return position + ufpeg::span(set, this->data + position, this->length - position);
+        }
+
+        std::size_t get_length() const {
+            return this->length;
+        }
+    private:
+        const T *data;
+        const std::size_t length;
+    };
+}
+
+#endif
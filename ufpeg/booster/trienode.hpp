@@ -0,0 +1,14 @@
+#ifndef UFPEG_TRIE_NODE_HPP
+#define UFPEG_TRIE_NODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ufpeg {
+    struct TrieNode {
+        std::uint32_t alternative, best;
+        std::size_t begin, end;
+    };
+}
+
+#endif
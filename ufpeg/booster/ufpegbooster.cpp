@@ -1,39 +1,1320 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include <functional>
+#include <list>
+#include <system_error>
+#include <unordered_map>
+
 #include "bootstrap.hpp"
 #include "compiler.hpp"
 #include "executor.hpp"
+#include "session.hpp"
+#include "document.hpp"
+#include "scheduler.hpp"
 #include "nodevisitor.hpp"
 
-void dump(const std::u32string &text, const ufpeg::Node &node, std::size_t level = 0) {
-    std::cout << std::string(level, '\t') << u32tou8(node.name) << " " << node.start << ":" << node.stop << " " << u32tou8(text.substr(node.start, node.stop - node.start)) << std::endl;
+void dump(
+    const std::u32string &text,
+    const ufpeg::SymbolTable &symbols,
+    const ufpeg::Node &node,
+    std::size_t level = 0
+) {
+    const auto rule = node.get_rule();
+    const auto start = node.get_start(), stop = node.get_stop();
+
+    std::cout << std::string(level, '\t') << (rule == ufpeg::NO_RULE ? "" : u32tou8(symbols.get_name(rule))) << " " << start << ":" << stop << " " << u32tou8(text.substr(start, stop - start)) << std::endl;
+
+    for (const auto &child: node) {
+        dump(text, symbols, child, level + 1);
+    }
+}
+
+void print(const ufpeg::Program &program) {
+    for (std::size_t offset = 0; offset < program.operations.size(); offset++) {
+        const auto &operation = program.operations[offset];
+
+        std::cout << "L" << offset << ": ";
+
+        switch (operation.opcode) {
+        case ufpeg::Opcode::INVOKE:
+            std::cout << "INVOKE " << operation.first << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::REVOKE_SUCCESS:
+            std::cout << "REVOKE_SUCCESS";
+            break;
+        case ufpeg::Opcode::REVOKE_FAILURE:
+            std::cout << "REVOKE_FAILURE";
+            break;
+        case ufpeg::Opcode::PREPARE:
+            std::cout << "PREPARE " << operation.target;
+            break;
+        case ufpeg::Opcode::CONSUME:
+            std::cout << "CONSUME \"" << u32tou8(program.symbols.get_name(operation.first)) << "\" " << operation.target;
+            break;
+        case ufpeg::Opcode::SPLICE:
+            std::cout << "SPLICE " << operation.target;
+            break;
+        case ufpeg::Opcode::CONSUME_REVOKE:
+            std::cout << "CONSUME_REVOKE " << operation.first;
+            break;
+        case ufpeg::Opcode::DISCARD_REVOKE:
+            std::cout << "DISCARD_REVOKE";
+            break;
+        case ufpeg::Opcode::TAIL_INVOKE:
+            std::cout << "TAIL_INVOKE " << operation.first << " " << operation.second;
+            break;
+        case ufpeg::Opcode::DISCARD:
+            std::cout << "DISCARD " << operation.target;
+            break;
+        case ufpeg::Opcode::BEGIN:
+            std::cout << "BEGIN " << operation.target;
+            break;
+        case ufpeg::Opcode::COMMIT:
+            std::cout << "COMMIT " << operation.target;
+            break;
+        case ufpeg::Opcode::ABORT:
+            std::cout << "ABORT " << operation.target;
+            break;
+        case ufpeg::Opcode::MATCH_LITERAL:
+            std::cout << "MATCH_LITERAL \"" << u32tou8(program.literals[operation.first]) << "\" " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::MATCH_RANGE:
+            std::cout << "MATCH_RANGE " << operation.first << " " << operation.second << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::MATCH_SET:
+            std::cout << "MATCH_SET " << operation.first << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::MATCH_LITERAL_NODE:
+            std::cout << "MATCH_LITERAL_NODE " << operation.first << " " << operation.second << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::MATCH_SET_NODE:
+            std::cout << "MATCH_SET_NODE " << operation.first << " " << operation.second << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::MATCH_LITERAL_SET:
+            std::cout << "MATCH_LITERAL_SET " << operation.first << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::TEST_SET:
+            std::cout << "TEST_SET " << operation.first << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::SPAN:
+            std::cout << "SPAN " << operation.first << " " << operation.target;
+            break;
+        case ufpeg::Opcode::JUMP:
+            std::cout << "JUMP " << operation.target;
+            break;
+        case ufpeg::Opcode::CUT:
+            std::cout << "CUT " << operation.target;
+            break;
+        case ufpeg::Opcode::SPLIT:
+            std::cout << "SPLIT " << operation.target << " " << operation.first << " " << operation.second;
+            break;
+        case ufpeg::Opcode::EXPECT:
+            std::cout << "EXPECT \"" << u32tou8(program.symbols.get_name(operation.first)) << "\" " << operation.target;
+            break;
+        case ufpeg::Opcode::RECALL:
+            std::cout << "RECALL " << operation.first << " " << operation.second << " " << operation.target << " " << operation.failure;
+            break;
+        case ufpeg::Opcode::MEMOIZE_SUCCESS:
+            std::cout << "MEMOIZE_SUCCESS " << operation.first << " " << operation.target;
+            break;
+        case ufpeg::Opcode::MEMOIZE_FAILURE:
+            std::cout << "MEMOIZE_FAILURE " << operation.first << " " << operation.target;
+            break;
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+std::u32string to_u32string(PyObject *pytext) {
+    if (!PyUnicode_Check(pytext)) {
+        PyErr_Format(PyExc_TypeError, "%R is not a string", pytext);
+        return {};
+    }
+
+    std::shared_ptr<Py_UCS4> pytext_data(PyUnicode_AsUCS4Copy(pytext), PyMem_Free);
+    if (PyErr_Occurred()) {
+        return {};
+    }
+
+    try {
+        return {
+            (char32_t*)pytext_data.get(),
+            (std::size_t)PyUnicode_GetLength(pytext),
+        };
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return {};
+    }
+}
+
+std::shared_ptr<const ufpeg::Executor> compile(
+    PyObject *pysource, const ufpeg::CompilerSettings &settings
+) {
+    // The grammar source is not translated into expressions yet, so every
+    // source is compiled into the bootstrap grammar for now.
+    auto rule = ufpeg::bootstrap();
+
+    try {
+        ufpeg::Compiler compiler(settings);
+
+        return std::make_shared<ufpeg::Executor>(compiler.compile(rule));
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return {};
+    }
+}
+
+class GrammarCache {
+public:
+    GrammarCache(std::size_t capacity, const ufpeg::CompilerSettings &settings = {}):
+        capacity(capacity), settings(settings) {}
+
+    std::shared_ptr<const ufpeg::Executor> get(PyObject *pysource) {
+        auto hash = PyObject_Hash(pysource);
+        if (hash == -1) {
+            return {};
+        }
+
+        auto it = this->index.find(hash);
+        if (it != this->index.end()) {
+            auto entry = it->second;
+
+            if (PyUnicode_Compare(entry->source, pysource) == 0) {
+                this->entries.splice(this->entries.begin(), this->entries, entry);
+                return entry->executor;
+            }
+
+            this->evict(entry);
+        }
+
+        auto executor = compile(pysource, this->settings);
+        if (!executor) {
+            return {};
+        }
+
+        Py_INCREF(pysource);
+        this->entries.push_front({ pysource, hash, executor });
+        this->index.emplace(hash, this->entries.begin());
+
+        if (this->entries.size() > this->capacity) {
+            this->evict(std::prev(this->entries.end()));
+        }
+
+        return executor;
+    }
+private:
+    struct Entry {
+        PyObject *source;
+        Py_hash_t hash;
+        std::shared_ptr<const ufpeg::Executor> executor;
+    };
+
+    void evict(std::list<Entry>::iterator entry) {
+        Py_DECREF(entry->source);
+        this->index.erase(entry->hash);
+        this->entries.erase(entry);
+    }
+
+    const std::size_t capacity;
+    const ufpeg::CompilerSettings settings;
+    std::list<Entry> entries;
+    std::unordered_map<Py_hash_t, std::list<Entry>::iterator> index;
+};
+
+ufpeg::CompilerSettings make_settings(bool utf8, bool memoize, bool recognize, bool expect = false) {
+    ufpeg::CompilerSettings settings;
+    settings.utf8 = utf8;
+    settings.memoize = memoize;
+    settings.recognize = recognize;
+    settings.expect = expect;
+    return settings;
+}
+
+GrammarCache grammar_caches[] = {
+    { 128, make_settings(false, false, false) },
+    { 128, make_settings(true, false, false) },
+    { 128, make_settings(false, true, false) },
+    { 128, make_settings(true, true, false) },
+    { 128, make_settings(false, false, true) },
+    { 128, make_settings(true, false, true) },
+    { 128, make_settings(false, true, true) },
+    { 128, make_settings(true, true, true) },
+    { 128, make_settings(false, false, true, true) },
+    { 128, make_settings(true, false, true, true) },
+    { 128, make_settings(false, true, true, true) },
+    { 128, make_settings(true, true, true, true) },
+};
+
+// Trees carry no failure information, so only recognizers track it.
+GrammarCache &get_grammar_cache(bool utf8, bool memoize, bool recognize, bool expect = false) {
+    return grammar_caches[utf8 + 2 * memoize + 4 * (recognize + (recognize && expect))];
+}
+
+struct ParseResult {
+    ParseResult(
+        const std::shared_ptr<const ufpeg::Executor> &executor,
+        ufpeg::Tree &&tree,
+        PyObject *pytext,
+        bool utf8,
+        std::size_t base = 0
+    ):
+        executor(executor),
+        tree(std::make_shared<const ufpeg::Tree>(std::move(tree))),
+        pytext(pytext),
+        utf8(utf8),
+        base(base),
+        pynames(executor->get_program().symbols.get_size(), nullptr) {
+        Py_INCREF(this->pytext);
+    }
+
+    // Documents share their tree and only make the text once it is asked
+    // for, since either would otherwise be copied on every edit.
+    ParseResult(
+        const std::shared_ptr<const ufpeg::Executor> &executor,
+        const std::shared_ptr<const ufpeg::Tree> &tree,
+        std::function<PyObject*()> &&make_text,
+        bool utf8
+    ):
+        executor(executor),
+        tree(tree),
+        pytext(nullptr),
+        make_text(std::move(make_text)),
+        utf8(utf8),
+        base(0),
+        pynames(executor->get_program().symbols.get_size(), nullptr) {}
+
+    ParseResult(const ParseResult&) = delete;
+
+    ~ParseResult() {
+        for (auto pyname: this->pynames) {
+            Py_XDECREF(pyname);
+        }
+
+        Py_XDECREF(this->pytext);
+    }
+
+    PyObject *get_text() {
+        if (!this->pytext) {
+            this->pytext = this->make_text();
+        }
+
+        return this->pytext;
+    }
+
+    const std::shared_ptr<const ufpeg::Executor> executor;
+    const std::shared_ptr<const ufpeg::Tree> tree;
+    PyObject *pytext;
+    std::function<PyObject*()> make_text;
+    const bool utf8;
+    const std::size_t base;
+    std::vector<PyObject*> pynames;
+};
+
+struct NodeProxy {
+    PyObject_HEAD
+    std::shared_ptr<ParseResult> result;
+    std::size_t index;
+};
+
+PyTypeObject *node_proxy_type;
+
+PyObject *NodeProxy_create(const std::shared_ptr<ParseResult> &result, std::size_t index) {
+    auto self = (NodeProxy*)node_proxy_type->tp_alloc(node_proxy_type, 0);
+    if (!self) {
+        return nullptr;
+    }
+
+    new (&self->result) std::shared_ptr<ParseResult>(result);
+    self->index = index;
+
+    return (PyObject*)self;
+}
+
+PyObject *NodeProxy_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    PyErr_Format(PyExc_TypeError, "cannot create '%s' instances", type->tp_name);
+
+    return nullptr;
+}
+
+void NodeProxy_dealloc(NodeProxy *self) {
+    auto type = Py_TYPE(self);
+
+    self->result.~shared_ptr();
+    type->tp_free(self);
+
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
+#endif
+}
+
+ufpeg::Node NodeProxy_node(NodeProxy *self) {
+    return self->result->tree->get_node(self->index);
+}
+
+PyObject *NodeProxy_get_name(NodeProxy *self, void *closure) {
+    const auto rule = NodeProxy_node(self).get_rule();
+
+    auto &pyname = self->result->pynames[rule];
+    if (!pyname) {
+        const auto &name = self->result->executor->get_program().symbols.get_name(rule);
+
+        pyname = PyUnicode_FromKindAndData(
+            PyUnicode_4BYTE_KIND, name.data(), name.length()
+        );
+        if (!pyname) {
+            return nullptr;
+        }
+    }
+
+    Py_INCREF(pyname);
+
+    return pyname;
+}
+
+PyObject *NodeProxy_get_start(NodeProxy *self, void *closure) {
+    return PyLong_FromSize_t(NodeProxy_node(self).get_start());
+}
+
+PyObject *NodeProxy_get_stop(NodeProxy *self, void *closure) {
+    return PyLong_FromSize_t(NodeProxy_node(self).get_stop());
+}
+
+PyObject *NodeProxy_get_text(NodeProxy *self, void *closure) {
+    const auto node = NodeProxy_node(self);
+    const auto base = self->result->base;
+    const auto start = (Py_ssize_t)(node.get_start() - base), stop = (Py_ssize_t)(node.get_stop() - base);
+    auto pytext = self->result->get_text();
+    if (!pytext) {
+        return nullptr;
+    }
+
+    if (PyUnicode_Check(pytext)) {
+        if (!self->result->utf8) {
+            return PyUnicode_Substring(pytext, start, stop);
+        }
+
+        auto data = PyUnicode_AsUTF8(pytext);
+        if (!data) {
+            return nullptr;
+        }
+
+        return PyUnicode_DecodeUTF8(data + start, stop - start, nullptr);
+    }
+
+    PyObject *pyview = PyMemoryView_FromObject(pytext);
+    if (!pyview) {
+        return nullptr;
+    }
+
+    PyObject *pyslice = PySequence_GetSlice(pyview, start, stop);
+    Py_DECREF(pyview);
+
+    return pyslice;
+}
+
+PyObject *NodeProxy_get_children(NodeProxy *self, void *closure) {
+    const auto node = NodeProxy_node(self);
+
+    PyObject *pychildren = PyTuple_New(std::distance(node.begin(), node.end()));
+    if (!pychildren) {
+        return nullptr;
+    }
+
+    Py_ssize_t i = 0;
+
+    for (const auto &child: node) {
+        PyObject *pychild = NodeProxy_create(self->result, child.get_index());
+        if (!pychild) {
+            Py_DECREF(pychildren);
+            return nullptr;
+        }
+
+        PyTuple_SET_ITEM(pychildren, i++, pychild);
+    }
+
+    return pychildren;
+}
+
+PyObject *NodeProxy_repr(NodeProxy *self) {
+    PyObject *pyname = NodeProxy_get_name(self, nullptr);
+    if (!pyname) {
+        return nullptr;
+    }
+
+    const auto node = NodeProxy_node(self);
+
+    PyObject *pyrepr = PyUnicode_FromFormat(
+        "<Node %R %zu:%zu>", pyname, node.get_start(), node.get_stop()
+    );
+    Py_DECREF(pyname);
+
+    return pyrepr;
+}
+
+// Inputs shorter than this are parsed without releasing the GIL, since
+// switching the thread state would cost more than the parse itself.
+const std::size_t GIL_RELEASE_THRESHOLD = 2048;
+
+class GilRelease {
+public:
+    GilRelease(bool enabled = true):
+        state(enabled ? PyEval_SaveThread() : nullptr) {}
+
+    GilRelease(const GilRelease&) = delete;
+
+    ~GilRelease() {
+        if (this->state) {
+            PyEval_RestoreThread(this->state);
+        }
+    }
+private:
+    PyThreadState *const state;
+};
+
+class ParseInput {
+public:
+    ParseInput():
+        data(nullptr), length(0), kind(PyUnicode_1BYTE_KIND), buffer() {}
+
+    ParseInput(const ParseInput&) = delete;
+
+    ~ParseInput() {
+        if (this->buffer.obj) {
+            PyBuffer_Release(&this->buffer);
+        }
+    }
+
+    bool load(PyObject *pytext, bool utf8) {
+        if (PyUnicode_Check(pytext)) {
+#if PY_VERSION_HEX < 0x030C0000
+            if (PyUnicode_READY(pytext) < 0) {
+                return false;
+            }
+#endif
+
+            if (utf8) {
+                Py_ssize_t length;
+                this->data = PyUnicode_AsUTF8AndSize(pytext, &length);
+                if (!this->data) {
+                    return false;
+                }
+
+                this->length = length;
+
+                return true;
+            }
+
+            this->data = PyUnicode_DATA(pytext);
+            this->length = PyUnicode_GET_LENGTH(pytext);
+            this->kind = PyUnicode_KIND(pytext);
+
+            return true;
+        }
+
+        if (utf8 && PyObject_CheckBuffer(pytext)) {
+            if (PyObject_GetBuffer(pytext, &this->buffer, PyBUF_SIMPLE) < 0) {
+                return false;
+            }
+
+            this->data = this->buffer.buf;
+            this->length = this->buffer.len;
+
+            return true;
+        }
+
+        PyErr_Format(PyExc_TypeError, "%R is not a string", pytext);
+
+        return false;
+    }
+
+    ufpeg::Tree execute(const ufpeg::Executor &executor, ufpeg::ExecutorContext &context) const {
+        switch (this->kind) {
+        case PyUnicode_1BYTE_KIND:
+            return executor.execute(context, (const Py_UCS1*)this->data, this->length);
+        case PyUnicode_2BYTE_KIND:
+            return executor.execute(context, (const Py_UCS2*)this->data, this->length);
+        default:
+            return executor.execute(context, (const Py_UCS4*)this->data, this->length);
+        }
+    }
+
+    ufpeg::Recognition recognize(const ufpeg::Executor &executor, ufpeg::ExecutorContext &context) const {
+        switch (this->kind) {
+        case PyUnicode_1BYTE_KIND:
+            return executor.recognize(context, (const Py_UCS1*)this->data, this->length);
+        case PyUnicode_2BYTE_KIND:
+            return executor.recognize(context, (const Py_UCS2*)this->data, this->length);
+        default:
+            return executor.recognize(context, (const Py_UCS4*)this->data, this->length);
+        }
+    }
+
+    std::size_t get_length() const {
+        return this->length;
+    }
+private:
+    const void *data;
+    std::size_t length;
+    int kind;
+    Py_buffer buffer;
+};
+
+struct Grammar {
+    PyObject_HEAD
+    std::shared_ptr<const ufpeg::Executor> executor;
+    std::shared_ptr<const ufpeg::Executor> recognizer;
+    std::shared_ptr<const ufpeg::Executor> tracker;
+    PyObject *source;
+    bool utf8;
+    bool memoize;
+};
+
+PyObject *Grammar_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "source", "utf8", "memoize", nullptr };
+    PyObject *pysource;
+    int utf8 = 0, memoize = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "U|pp", (char**)keywords, &pysource, &utf8, &memoize)) {
+        return nullptr;
+    }
+
+    auto executor = get_grammar_cache(utf8, memoize, false).get(pysource);
+    if (!executor) {
+        return nullptr;
+    }
+
+    auto self = (Grammar*)type->tp_alloc(type, 0);
+    if (!self) {
+        return nullptr;
+    }
+
+    new (&self->executor) std::shared_ptr<const ufpeg::Executor>(executor);
+    new (&self->recognizer) std::shared_ptr<const ufpeg::Executor>();
+    new (&self->tracker) std::shared_ptr<const ufpeg::Executor>();
+    Py_INCREF(pysource);
+    self->source = pysource;
+    self->utf8 = utf8;
+    self->memoize = memoize;
+
+    return (PyObject*)self;
+}
+
+void Grammar_dealloc(Grammar *self) {
+    auto type = Py_TYPE(self);
+
+    self->executor.~shared_ptr();
+    self->recognizer.~shared_ptr();
+    self->tracker.~shared_ptr();
+    Py_DECREF(self->source);
+    type->tp_free(self);
+
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
+#endif
+}
+
+PyObject *Grammar_result(Grammar *self, ufpeg::Tree &&tree, PyObject *pytext) {
+    if (tree.get_root().is_leaf()) {
+        Py_RETURN_NONE;
+    }
+
+    auto result = std::make_shared<ParseResult>(
+        self->executor, std::move(tree), pytext, self->utf8
+    );
+
+    return NodeProxy_create(result, (*result->tree->get_root().begin()).get_index());
+}
+
+PyObject *Grammar_parse(Grammar *self, PyObject *args) {
+    PyObject *pytext;
+
+    if (!PyArg_ParseTuple(args, "O", &pytext)) {
+        return nullptr;
+    }
+
+    ParseInput input;
+    if (!input.load(pytext, self->utf8)) {
+        return nullptr;
+    }
+
+    try {
+        ufpeg::Tree tree;
+        ufpeg::ExecutorContext context;
+
+        {
+            GilRelease release(input.get_length() >= GIL_RELEASE_THRESHOLD);
+
+            tree = input.execute(*self->executor, context);
+        }
+
+        return Grammar_result(self, std::move(tree), pytext);
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+}
+
+// The recognizer is the same grammar compiled without node bookkeeping, and
+// the tracker is a recognizer that also records the furthest failure. Each
+// is only compiled the first time match() or error() needs it.
+bool Grammar_recognize(Grammar *self, PyObject *args, bool expect, ufpeg::Recognition &recognition) {
+    PyObject *pytext;
+
+    if (!PyArg_ParseTuple(args, "O", &pytext)) {
+        return false;
+    }
+
+    ParseInput input;
+    if (!input.load(pytext, self->utf8)) {
+        return false;
+    }
+
+    auto &recognizer = expect ? self->tracker : self->recognizer;
+
+    if (!recognizer) {
+        recognizer = get_grammar_cache(self->utf8, self->memoize, true, expect).get(self->source);
+        if (!recognizer) {
+            return false;
+        }
+    }
+
+    try {
+        ufpeg::ExecutorContext context;
+        GilRelease release(input.get_length() >= GIL_RELEASE_THRESHOLD);
+
+        recognition = input.recognize(*recognizer, context);
+
+        return true;
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return false;
+    }
+}
+
+PyObject *Grammar_match(Grammar *self, PyObject *args) {
+    ufpeg::Recognition recognition;
+
+    if (!Grammar_recognize(self, args, false, recognition)) {
+        return nullptr;
+    }
+
+    if (!recognition.matched) {
+        Py_RETURN_NONE;
+    }
+
+    return PyLong_FromSize_t(recognition.length);
+}
+
+PyObject *Grammar_error(Grammar *self, PyObject *args) {
+    ufpeg::Recognition recognition;
+
+    if (!Grammar_recognize(self, args, true, recognition)) {
+        return nullptr;
+    }
+
+    if (recognition.matched) {
+        Py_RETURN_NONE;
+    }
+
+    std::vector<std::u32string> names;
+
+    try {
+        names = recognition.get_expected(self->tracker->get_program().symbols);
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+
+    PyObject *pynames = PyList_New(names.size());
+    if (!pynames) {
+        return nullptr;
+    }
+
+    for (std::size_t i = 0; i < names.size(); i++) {
+        auto pyname = PyUnicode_FromKindAndData(
+            PyUnicode_4BYTE_KIND, names[i].data(), names[i].length()
+        );
+        if (!pyname) {
+            Py_DECREF(pynames);
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(pynames, i, pyname);
+    }
+
+    return Py_BuildValue("(nN)", (Py_ssize_t)recognition.offset, pynames);
+}
+
+PyObject *Grammar_parse_many(Grammar *self, PyObject *args, PyObject *kwargs) {
+    static const char *keywords[] = { "texts", "threads", nullptr };
+    PyObject *pytexts;
+    Py_ssize_t threads = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|n", (char**)keywords, &pytexts, &threads)) {
+        return nullptr;
+    }
+
+    if (threads < 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+        return nullptr;
+    }
+
+    PyObject *pysequence = PySequence_Fast(pytexts, "texts must be iterable");
+    if (!pysequence) {
+        return nullptr;
+    }
+
+    std::shared_ptr<PyObject> guard(pysequence, Py_DecRef);
+
+    const auto count = (std::size_t)PySequence_Fast_GET_SIZE(pysequence);
+    const auto pyitems = PySequence_Fast_ITEMS(pysequence);
+
+    try {
+        std::unique_ptr<ParseInput[]> inputs(new ParseInput[count]);
+
+        for (std::size_t i = 0; i < count; i++) {
+            if (!inputs[i].load(pyitems[i], self->utf8)) {
+                return nullptr;
+            }
+        }
+
+        const ufpeg::Scheduler scheduler(threads);
+        const auto &executor = *self->executor;
+        std::vector<ufpeg::ExecutorContext> contexts(scheduler.get_threads());
+        std::vector<ufpeg::Tree> trees(count);
+
+        {
+            GilRelease release;
+
+            scheduler.run(count, [&](std::size_t worker, std::size_t index) {
+                trees[index] = inputs[index].execute(executor, contexts[worker]);
+            });
+        }
+
+        PyObject *pyresults = PyList_New(count);
+        if (!pyresults) {
+            return nullptr;
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            PyObject *pyresult;
+
+            try {
+                pyresult = Grammar_result(self, std::move(trees[i]), pyitems[i]);
+            } catch (std::bad_alloc&) {
+                Py_DECREF(pyresults);
+                throw;
+            }
+
+            if (!pyresult) {
+                Py_DECREF(pyresults);
+                return nullptr;
+            }
+
+            PyList_SET_ITEM(pyresults, i, pyresult);
+        }
+
+        return pyresults;
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return nullptr;
+    } catch (std::system_error &error) {
+        PyErr_SetString(PyExc_RuntimeError, error.what());
+        return nullptr;
+    }
+}
+
+struct ParseSession {
+    PyObject_HEAD
+    std::shared_ptr<const ufpeg::Executor> executor;
+    std::unique_ptr<ufpeg::Session<char32_t>> session;
+    std::unique_ptr<ufpeg::Session<unsigned char>> utf8_session;
+    bool closed;
+};
+
+PyTypeObject *session_type;
+
+PyObject *Grammar_session(Grammar *self, PyObject *args) {
+    auto session = (ParseSession*)session_type->tp_alloc(session_type, 0);
+    if (!session) {
+        return nullptr;
+    }
+
+    new (&session->executor) std::shared_ptr<const ufpeg::Executor>(self->executor);
+    new (&session->session) std::unique_ptr<ufpeg::Session<char32_t>>();
+    new (&session->utf8_session) std::unique_ptr<ufpeg::Session<unsigned char>>();
+    session->closed = false;
 
-    for (const auto &child: node.children) {
-        dump(text, child, level + 1);
+    try {
+        if (self->utf8) {
+            session->utf8_session.reset(new ufpeg::Session<unsigned char>(*self->executor));
+        } else {
+            session->session.reset(new ufpeg::Session<char32_t>(*self->executor));
+        }
+    } catch (std::bad_alloc&) {
+        Py_DECREF(session);
+        PyErr_NoMemory();
+        return nullptr;
     }
+
+    return (PyObject*)session;
 }
 
-std::u32string to_u32string(PyObject *pytext) {
-    if (!PyUnicode_Check(pytext)) {
+struct ParseDocument {
+    PyObject_HEAD
+    std::shared_ptr<const ufpeg::Executor> executor;
+    std::shared_ptr<ufpeg::Document<char32_t>> document;
+    std::shared_ptr<ufpeg::Document<unsigned char>> utf8_document;
+    PyObject *pyroot;
+};
+
+PyTypeObject *document_type;
+
+bool ParseDocument_convert(PyObject *pytext, std::vector<char32_t> &text) {
+    const auto data = to_u32string(pytext);
+    if (PyErr_Occurred()) {
+        return false;
+    }
+
+    text.assign(data.begin(), data.end());
+
+    return true;
+}
+
+bool ParseDocument_convert(PyObject *pytext, std::vector<unsigned char> &text) {
+    if (PyUnicode_Check(pytext)) {
+        Py_ssize_t length;
+        auto data = (const unsigned char*)PyUnicode_AsUTF8AndSize(pytext, &length);
+        if (!data) {
+            return false;
+        }
+
+        text.assign(data, data + length);
+
+        return true;
+    }
+
+    if (!PyObject_CheckBuffer(pytext)) {
         PyErr_Format(PyExc_TypeError, "%R is not a string", pytext);
+        return false;
+    }
+
+    Py_buffer buffer;
+    if (PyObject_GetBuffer(pytext, &buffer, PyBUF_SIMPLE) < 0) {
+        return false;
+    }
+
+    std::shared_ptr<Py_buffer> guard(&buffer, PyBuffer_Release);
+
+    auto data = (const unsigned char*)buffer.buf;
+    text.assign(data, data + buffer.len);
+
+    return true;
+}
+
+PyObject *ParseDocument_text(const ufpeg::Document<char32_t> &document) {
+    const auto &text = document.get_text();
+
+    return PyUnicode_FromKindAndData(PyUnicode_4BYTE_KIND, text.data(), text.size());
+}
+
+PyObject *ParseDocument_text(const ufpeg::Document<unsigned char> &document) {
+    const auto &text = document.get_text();
+
+    return PyBytes_FromStringAndSize((const char*)text.data(), text.size());
+}
+
+template <typename T>
+PyObject *ParseDocument_root(ParseDocument *self, const std::shared_ptr<ufpeg::Document<T>> &document) {
+    const auto tree = document->get_tree();
+
+    if (tree->get_root().is_leaf()) {
+        Py_RETURN_NONE;
+    }
+
+    std::shared_ptr<ParseResult> result;
+
+    try {
+        result = std::make_shared<ParseResult>(
+            self->executor, tree, [document]() {
+                return ParseDocument_text(*document);
+            }, !!self->utf8_document
+        );
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+
+    return NodeProxy_create(result, (*result->tree->get_root().begin()).get_index());
+}
+
+template <typename T>
+std::shared_ptr<ufpeg::Document<T>> ParseDocument_create(const ufpeg::Executor &executor, PyObject *pytext) {
+    std::vector<T> text;
+    if (!ParseDocument_convert(pytext, text)) {
         return {};
     }
 
-    std::shared_ptr<Py_UCS4> pytext_data(PyUnicode_AsUCS4Copy(pytext), PyMem_Free);
-    if (PyErr_Occurred()) {
+    try {
+        return std::make_shared<ufpeg::Document<T>>(executor, text.data(), text.size());
+    } catch (std::invalid_argument&) {
+        PyErr_SetString(PyExc_ValueError, "documents need a grammar with memoize=True");
         return {};
     }
+}
+
+PyObject *Grammar_document(Grammar *self, PyObject *args) {
+    PyObject *pytext;
+
+    if (!PyArg_ParseTuple(args, "O", &pytext)) {
+        return nullptr;
+    }
+
+    auto document = (ParseDocument*)document_type->tp_alloc(document_type, 0);
+    if (!document) {
+        return nullptr;
+    }
+
+    new (&document->executor) std::shared_ptr<const ufpeg::Executor>(self->executor);
+    new (&document->document) std::shared_ptr<ufpeg::Document<char32_t>>();
+    new (&document->utf8_document) std::shared_ptr<ufpeg::Document<unsigned char>>();
+    document->pyroot = nullptr;
 
     try {
-        return {
-            (char32_t*)pytext_data.get(),
-            (std::size_t)PyUnicode_GetLength(pytext),
-        };
+        if (self->utf8) {
+            document->utf8_document = ParseDocument_create<unsigned char>(*self->executor, pytext);
+            if (document->utf8_document) {
+                document->pyroot = ParseDocument_root(document, document->utf8_document);
+            }
+        } else {
+            document->document = ParseDocument_create<char32_t>(*self->executor, pytext);
+            if (document->document) {
+                document->pyroot = ParseDocument_root(document, document->document);
+            }
+        }
     } catch (std::bad_alloc&) {
+        Py_DECREF(document);
         PyErr_NoMemory();
-        return {};
+        return nullptr;
+    }
+
+    if (!document->pyroot) {
+        Py_DECREF(document);
+        return nullptr;
+    }
+
+    return (PyObject*)document;
+}
+
+PyObject *Grammar_disassemble(Grammar *self, PyObject *args) {
+    print(self->executor->get_program());
+
+    Py_RETURN_NONE;
+}
+
+PyObject *ParseSession_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    PyErr_Format(PyExc_TypeError, "cannot create '%s' instances", type->tp_name);
+
+    return nullptr;
+}
+
+void ParseSession_dealloc(ParseSession *self) {
+    auto type = Py_TYPE(self);
+
+    self->utf8_session.~unique_ptr();
+    self->session.~unique_ptr();
+    self->executor.~shared_ptr();
+    type->tp_free(self);
+
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
+#endif
+}
+
+PyObject *ParseSession_slice(const ufpeg::Session<char32_t> &session, const ufpeg::Node &node) {
+    return PyUnicode_FromKindAndData(
+        PyUnicode_4BYTE_KIND, session.get_data(node.get_start()), node.get_stop() - node.get_start()
+    );
+}
+
+PyObject *ParseSession_slice(const ufpeg::Session<unsigned char> &session, const ufpeg::Node &node) {
+    return PyBytes_FromStringAndSize(
+        (const char*)session.get_data(node.get_start()), node.get_stop() - node.get_start()
+    );
+}
+
+template <typename T>
+PyObject *ParseSession_nodes(
+    ParseSession *self, const ufpeg::Session<T> &session, std::vector<ufpeg::Tree> &&trees
+) {
+    PyObject *pynodes = PyTuple_New(trees.size());
+    if (!pynodes) {
+        return nullptr;
+    }
+
+    for (std::size_t i = 0; i < trees.size(); i++) {
+        const auto node = trees[i].get_root();
+        const auto base = node.get_start();
+
+        PyObject *pytext = ParseSession_slice(session, node);
+        if (!pytext) {
+            Py_DECREF(pynodes);
+            return nullptr;
+        }
+
+        std::shared_ptr<ParseResult> result;
+
+        try {
+            result = std::make_shared<ParseResult>(
+                self->executor, std::move(trees[i]), pytext, !!self->utf8_session, base
+            );
+        } catch (std::bad_alloc&) {
+            Py_DECREF(pytext);
+            Py_DECREF(pynodes);
+            PyErr_NoMemory();
+            return nullptr;
+        }
+
+        Py_DECREF(pytext);
+
+        PyObject *pynode = NodeProxy_create(result, 0);
+        if (!pynode) {
+            Py_DECREF(pynodes);
+            return nullptr;
+        }
+
+        PyTuple_SET_ITEM(pynodes, i, pynode);
+    }
+
+    return pynodes;
+}
+
+PyObject *ParseSession_feed(ParseSession *self, PyObject *args) {
+    PyObject *pychunk;
+
+    if (!PyArg_ParseTuple(args, "O", &pychunk)) {
+        return nullptr;
+    }
+
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "session is closed");
+        return nullptr;
+    }
+
+    try {
+        if (self->utf8_session) {
+            auto &session = *self->utf8_session;
+
+            if (PyUnicode_Check(pychunk)) {
+                Py_ssize_t length;
+                auto data = PyUnicode_AsUTF8AndSize(pychunk, &length);
+                if (!data) {
+                    return nullptr;
+                }
+
+                return ParseSession_nodes(self, session, session.feed((const unsigned char*)data, length));
+            }
+
+            if (!PyObject_CheckBuffer(pychunk)) {
+                PyErr_Format(PyExc_TypeError, "%R is not a string", pychunk);
+                return nullptr;
+            }
+
+            Py_buffer buffer;
+            if (PyObject_GetBuffer(pychunk, &buffer, PyBUF_SIMPLE) < 0) {
+                return nullptr;
+            }
+
+            std::shared_ptr<Py_buffer> guard(&buffer, PyBuffer_Release);
+
+            return ParseSession_nodes(
+                self, session, session.feed((const unsigned char*)buffer.buf, buffer.len)
+            );
+        }
+
+        auto &session = *self->session;
+        std::u32string chunk = to_u32string(pychunk);
+        if (PyErr_Occurred()) {
+            return nullptr;
+        }
+
+        return ParseSession_nodes(self, session, session.feed(chunk.data(), chunk.length()));
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+}
+
+template <typename T>
+PyObject *ParseSession_finish(ParseSession *self, ufpeg::Session<T> &session) {
+    auto trees = session.close();
+
+    if (!session.is_matched()) {
+        Py_RETURN_NONE;
+    }
+
+    return ParseSession_nodes(self, session, std::move(trees));
+}
+
+PyObject *ParseSession_close(ParseSession *self, PyObject *args) {
+    if (self->closed) {
+        PyErr_SetString(PyExc_ValueError, "session is closed");
+        return nullptr;
+    }
+
+    self->closed = true;
+
+    try {
+        if (self->utf8_session) {
+            return ParseSession_finish(self, *self->utf8_session);
+        }
+
+        return ParseSession_finish(self, *self->session);
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+}
+
+PyObject *ParseDocument_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    PyErr_Format(PyExc_TypeError, "cannot create '%s' instances", type->tp_name);
+
+    return nullptr;
+}
+
+void ParseDocument_dealloc(ParseDocument *self) {
+    auto type = Py_TYPE(self);
+
+    Py_XDECREF(self->pyroot);
+    self->utf8_document.~shared_ptr();
+    self->document.~shared_ptr();
+    self->executor.~shared_ptr();
+    type->tp_free(self);
+
+#if PY_VERSION_HEX >= 0x03080000
+    Py_DECREF(type);
+#endif
+}
+
+template <typename T>
+PyObject *ParseDocument_update(ParseDocument *self, const std::shared_ptr<ufpeg::Document<T>> &document, PyObject *pyedits) {
+    struct Edit {
+        std::size_t offset, removed;
+        std::vector<T> text;
+    };
+
+    PyObject *pyiterator = PyObject_GetIter(pyedits);
+    if (!pyiterator) {
+        return nullptr;
+    }
+
+    std::vector<Edit> edits;
+    auto length = document->get_text().size();
+
+    while (PyObject *pyedit = PyIter_Next(pyiterator)) {
+        Py_ssize_t offset, removed;
+        PyObject *pyinserted;
+
+        if (!PyTuple_Check(pyedit)) {
+            PyErr_Format(PyExc_TypeError, "%R is not an edit", pyedit);
+            Py_DECREF(pyedit);
+            break;
+        }
+
+        if (!PyArg_ParseTuple(pyedit, "nnO", &offset, &removed, &pyinserted)) {
+            Py_DECREF(pyedit);
+            break;
+        }
+
+        Edit edit = { (std::size_t)offset, (std::size_t)removed };
+
+        if (offset < 0 || removed < 0 || edit.offset > length || edit.removed > length - edit.offset) {
+            PyErr_Format(PyExc_ValueError, "%R is out of range", pyedit);
+            Py_DECREF(pyedit);
+            break;
+        }
+
+        Py_DECREF(pyedit);
+
+        if (!ParseDocument_convert(pyinserted, edit.text)) {
+            break;
+        }
+
+        length = length - edit.removed + edit.text.size();
+        edits.emplace_back(std::move(edit));
+    }
+
+    Py_DECREF(pyiterator);
+
+    if (PyErr_Occurred()) {
+        return nullptr;
+    }
+
+    // Nodes still around from before keep the text they were parsed from,
+    // and the tree is only parsed again in place once nothing else has it.
+    if (self->pyroot != Py_None) {
+        auto &result = ((NodeProxy*)self->pyroot)->result;
+        if ((Py_REFCNT(self->pyroot) > 1 || result.use_count() > 1) && !result->get_text()) {
+            return nullptr;
+        }
+    }
+
+    Py_DECREF(self->pyroot);
+    Py_INCREF(Py_None);
+    self->pyroot = Py_None;
+
+    for (const auto &edit: edits) {
+        document->edit(edit.offset, edit.removed, edit.text.data(), edit.text.size());
+    }
+
+    document->parse();
+
+    PyObject *pyroot = ParseDocument_root(self, document);
+    if (!pyroot) {
+        return nullptr;
+    }
+
+    Py_XDECREF(self->pyroot);
+    self->pyroot = pyroot;
+
+    Py_INCREF(pyroot);
+
+    return pyroot;
+}
+
+PyObject *ParseDocument_edit(ParseDocument *self, PyObject *args) {
+    PyObject *pyedits;
+
+    if (!PyArg_ParseTuple(args, "O", &pyedits)) {
+        return nullptr;
+    }
+
+    try {
+        if (self->utf8_document) {
+            return ParseDocument_update(self, self->utf8_document, pyedits);
+        }
+
+        return ParseDocument_update(self, self->document, pyedits);
+    } catch (std::bad_alloc&) {
+        PyErr_NoMemory();
+        return nullptr;
+    }
+}
+
+PyObject *ParseDocument_get_root(ParseDocument *self, void *closure) {
+    Py_INCREF(self->pyroot);
+
+    return self->pyroot;
+}
+
+PyObject *ParseDocument_get_text(ParseDocument *self, void *closure) {
+    if (self->utf8_document) {
+        return ParseDocument_text(*self->utf8_document);
     }
+
+    return ParseDocument_text(*self->document);
 }
 
 PyObject *run(PyObject *self, PyObject *args) {
@@ -49,19 +1330,14 @@ PyObject *run(PyObject *self, PyObject *args) {
         return nullptr;
     }
 
-    auto rule = ufpeg::bootstrap();
-
-    ufpeg::Compiler compiler;
-    auto instructions = compiler.compile(rule);
-    for (auto instruction: instructions) {
-        std::cout << "L" << instruction->get_reference()->get_offset() << ": ";
-        instruction->print();
+    auto executor = get_grammar_cache(false, false, false).get(pygrammar);
+    if (!executor) {
+        return nullptr;
     }
 
-    ufpeg::Executor executor(instructions);
-    auto node = executor.execute(grammar);
+    auto tree = executor->execute(grammar);
 
-    dump(grammar, node);
+    dump(grammar, executor->get_program().symbols, tree.get_root());
 
     // ufpeg::NodeVisitor<std::shared_ptr<ufpeg::Expression>> expression_visitor;
 
@@ -88,5 +1364,155 @@ PyMODINIT_FUNC PyInit_booster() {
         methods,
     };
 
-    return PyModule_Create(&moduledef);
+    static PyMethodDef grammar_methods[] = {
+        { "parse", (PyCFunction)Grammar_parse, METH_VARARGS, nullptr },
+        { "match", (PyCFunction)Grammar_match, METH_VARARGS, nullptr },
+        { "error", (PyCFunction)Grammar_error, METH_VARARGS, nullptr },
+        { "parse_many", (PyCFunction)Grammar_parse_many, METH_VARARGS | METH_KEYWORDS, nullptr },
+        { "session", (PyCFunction)Grammar_session, METH_NOARGS, nullptr },
+        { "document", (PyCFunction)Grammar_document, METH_VARARGS, nullptr },
+        { "disassemble", (PyCFunction)Grammar_disassemble, METH_NOARGS, nullptr },
+        { nullptr },
+    };
+
+    static PyMethodDef session_methods[] = {
+        { "feed", (PyCFunction)ParseSession_feed, METH_VARARGS, nullptr },
+        { "close", (PyCFunction)ParseSession_close, METH_NOARGS, nullptr },
+        { nullptr },
+    };
+
+    static PyType_Slot session_slots[] = {
+        { Py_tp_new, (void*)ParseSession_new },
+        { Py_tp_dealloc, (void*)ParseSession_dealloc },
+        { Py_tp_methods, session_methods },
+        { 0, nullptr },
+    };
+
+    static PyType_Spec session_spec = {
+        "ufpeg.booster.Session",
+        sizeof(ParseSession),
+        0,
+        Py_TPFLAGS_DEFAULT,
+        session_slots,
+    };
+
+    static PyMethodDef document_methods[] = {
+        { "edit", (PyCFunction)ParseDocument_edit, METH_VARARGS, nullptr },
+        { nullptr },
+    };
+
+    static PyGetSetDef document_getset[] = {
+        { (char*)"root", (getter)ParseDocument_get_root, nullptr, nullptr, nullptr },
+        { (char*)"text", (getter)ParseDocument_get_text, nullptr, nullptr, nullptr },
+        { nullptr },
+    };
+
+    static PyType_Slot document_slots[] = {
+        { Py_tp_new, (void*)ParseDocument_new },
+        { Py_tp_dealloc, (void*)ParseDocument_dealloc },
+        { Py_tp_methods, document_methods },
+        { Py_tp_getset, document_getset },
+        { 0, nullptr },
+    };
+
+    static PyType_Spec document_spec = {
+        "ufpeg.booster.Document",
+        sizeof(ParseDocument),
+        0,
+        Py_TPFLAGS_DEFAULT,
+        document_slots,
+    };
+
+    static PyType_Slot grammar_slots[] = {
+        { Py_tp_new, (void*)Grammar_new },
+        { Py_tp_dealloc, (void*)Grammar_dealloc },
+        { Py_tp_methods, grammar_methods },
+        { 0, nullptr },
+    };
+
+    static PyType_Spec grammar_spec = {
+        "ufpeg.booster.Grammar",
+        sizeof(Grammar),
+        0,
+        Py_TPFLAGS_DEFAULT,
+        grammar_slots,
+    };
+
+    static PyGetSetDef node_proxy_getset[] = {
+        { (char*)"name", (getter)NodeProxy_get_name, nullptr, nullptr, nullptr },
+        { (char*)"start", (getter)NodeProxy_get_start, nullptr, nullptr, nullptr },
+        { (char*)"stop", (getter)NodeProxy_get_stop, nullptr, nullptr, nullptr },
+        { (char*)"text", (getter)NodeProxy_get_text, nullptr, nullptr, nullptr },
+        { (char*)"children", (getter)NodeProxy_get_children, nullptr, nullptr, nullptr },
+        { nullptr },
+    };
+
+    static PyType_Slot node_proxy_slots[] = {
+        { Py_tp_new, (void*)NodeProxy_new },
+        { Py_tp_dealloc, (void*)NodeProxy_dealloc },
+        { Py_tp_repr, (void*)NodeProxy_repr },
+        { Py_tp_getset, node_proxy_getset },
+        { 0, nullptr },
+    };
+
+    static PyType_Spec node_proxy_spec = {
+        "ufpeg.booster.Node",
+        sizeof(NodeProxy),
+        0,
+        Py_TPFLAGS_DEFAULT,
+        node_proxy_slots,
+    };
+
+    PyObject *module = PyModule_Create(&moduledef);
+    if (!module) {
+        return nullptr;
+    }
+
+    node_proxy_type = (PyTypeObject*)PyType_FromSpec(&node_proxy_spec);
+    if (!node_proxy_type) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    Py_INCREF(node_proxy_type);
+    if (PyModule_AddObject(module, "Node", (PyObject*)node_proxy_type) < 0) {
+        Py_DECREF(node_proxy_type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    session_type = (PyTypeObject*)PyType_FromSpec(&session_spec);
+    if (!session_type) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    Py_INCREF(session_type);
+    if (PyModule_AddObject(module, "Session", (PyObject*)session_type) < 0) {
+        Py_DECREF(session_type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    document_type = (PyTypeObject*)PyType_FromSpec(&document_spec);
+    if (!document_type) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    Py_INCREF(document_type);
+    if (PyModule_AddObject(module, "Document", (PyObject*)document_type) < 0) {
+        Py_DECREF(document_type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    PyObject *grammar_type = PyType_FromSpec(&grammar_spec);
+    if (!grammar_type || PyModule_AddObject(module, "Grammar", grammar_type) < 0) {
+        Py_XDECREF(grammar_type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+    return module;
 }
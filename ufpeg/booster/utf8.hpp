@@ -0,0 +1,97 @@
+#ifndef UFPEG_UTF8_HPP
+#define UFPEG_UTF8_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ufpeg {
+    typedef std::vector<std::pair<char32_t, char32_t>> ByteRanges;
+
+    inline std::u32string encode_utf8(char32_t code) {
+        if (code < 0x80) {
+            return { code };
+        } else if (code < 0x800) {
+            return {
+                0xC0 | (code >> 6),
+                0x80 | (code & 0x3F),
+            };
+        } else if (code < 0x10000) {
+            return {
+                0xE0 | (code >> 12),
+                0x80 | ((code >> 6) & 0x3F),
+                0x80 | (code & 0x3F),
+            };
+        } else {
+            return {
+                0xF0 | (code >> 18),
+                0x80 | ((code >> 12) & 0x3F),
+                0x80 | ((code >> 6) & 0x3F),
+                0x80 | (code & 0x3F),
+            };
+        }
+    }
+
+    inline std::u32string encode_utf8(const std::u32string &text) {
+        std::u32string bytes;
+
+        for (auto code: text) {
+            bytes += encode_utf8(code);
+        }
+
+        return bytes;
+    }
+
+    inline void split_utf8(char32_t min, char32_t max, std::vector<ByteRanges> &sequences) {
+        if (min > max) {
+            return;
+        }
+
+        if (min <= 0xDFFF && max >= 0xD800) {
+            if (min < 0xD800) {
+                split_utf8(min, 0xD7FF, sequences);
+            }
+            if (max > 0xDFFF) {
+                split_utf8(0xE000, max, sequences);
+            }
+            return;
+        }
+
+        for (char32_t limit: { 0x7F, 0x7FF, 0xFFFF }) {
+            if (min <= limit && limit < max) {
+                split_utf8(min, limit, sequences);
+                split_utf8(limit + 1, max, sequences);
+                return;
+            }
+        }
+
+        const auto first = encode_utf8(min), last = encode_utf8(max);
+
+        for (std::size_t i = 1; i < first.length(); i++) {
+            const char32_t mask = (1 << (6 * i)) - 1;
+
+            if ((min & ~mask) != (max & ~mask)) {
+                if (min & mask) {
+                    split_utf8(min, min | mask, sequences);
+                    split_utf8((min | mask) + 1, max, sequences);
+                    return;
+                }
+                if ((max & mask) != mask) {
+                    split_utf8(min, (max & ~mask) - 1, sequences);
+                    split_utf8(max & ~mask, max, sequences);
+                    return;
+                }
+            }
+        }
+
+        ByteRanges sequence;
+
+        for (std::size_t i = 0; i < first.length(); i++) {
+            sequence.emplace_back(first[i], last[i]);
+        }
+
+        sequences.emplace_back(sequence);
+    }
+}
+
+#endif